@@ -0,0 +1,119 @@
+#ifndef ASYNC_UNIQUIFY_H
+#define ASYNC_UNIQUIFY_H
+
+// Asynchronous variants of the `iterator_sorting.h` functions,
+// so that callers can overlap deduplication with other work
+// (e.g. deduplicate frame N while acquiring frame N + 1).
+//
+// The work is scheduled on the library's `default_scheduler()` and the
+// result is returned as a `std::future`. If the scheduler has no worker
+// threads (e.g. on a single-core machine), the work runs inline
+// and the returned future is already ready.
+//
+// Lifetime contract:
+// * The input range, and the comparators, must stay valid until the future
+//   is ready. Unlike futures from `std::async`, destroying the returned
+//   future does NOT wait for the work; always `wait()` or `get()` it before
+//   releasing the range.
+// * Until then, the range must not be written by anyone else; for the
+//   `_uniquify` variants, which reorder it, it must not be read either.
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "iterator_sorting.h"
+#include "task_scheduler.h"
+
+namespace iterator_sorting {
+
+// Runs `f()` on the `default_scheduler()` and returns a future of its result.
+// Exceptions thrown by `f` are delivered through the future.
+template <typename F>
+auto
+async_invoke(F f) -> std::future<decltype(f())>
+{
+  using Result = decltype(f());
+  auto promise = std::make_shared<std::promise<Result>>();
+  std::future<Result> future = promise->get_future();
+  default_scheduler().submit([promise, f = std::move(f)]() mutable {
+    try {
+      if constexpr (std::is_void_v<Result>) {
+        f();
+        promise->set_value();
+      } else {
+        promise->set_value(f());
+      }
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+  });
+  return future;
+}
+
+// Asynchronous `stable_unique_iterators()`. See the lifetime contract above.
+template <
+  typename It,
+  typename Compare = std::less<>,
+  typename EqualPred = std::equal_to<>
+>
+std::future<std::vector<It>>
+async_stable_unique_iterators(
+  const It begin,
+  const It end,
+  Compare comp = Compare{},
+  EqualPred equalPred = EqualPred{}
+)
+{
+  return async_invoke([=]{ return stable_unique_iterators(begin, end, comp, equalPred); });
+}
+
+// Asynchronous `stable_uniquify()`. See the lifetime contract above.
+template <
+  typename It,
+  typename Compare = std::less<>,
+  typename EqualPred = std::equal_to<>
+>
+std::future<It>
+async_stable_uniquify(
+  const It begin,
+  const It end,
+  Compare comp = Compare{},
+  EqualPred equalPred = EqualPred{}
+)
+{
+  return async_invoke([=]{ return stable_uniquify(begin, end, comp, equalPred); });
+}
+
+// Asynchronous `unstable_uniquify()`. See the lifetime contract above.
+template <
+  typename It,
+  typename Compare = std::less<>,
+  typename EqualPred = std::equal_to<>
+>
+std::future<It>
+async_unstable_uniquify(
+  const It begin,
+  const It end,
+  Compare comp = Compare{},
+  EqualPred equalPred = EqualPred{}
+)
+{
+  return async_invoke([=]{ return unstable_uniquify(begin, end, comp, equalPred); });
+}
+
+// Asynchronous `stable_uniquify_by()`. See the lifetime contract above.
+template <typename It, typename Proj = std::identity>
+std::future<It>
+async_stable_uniquify_by(const It begin, const It end, Proj proj = Proj{})
+{
+  return async_invoke([=]{ return stable_uniquify_by(begin, end, proj); });
+}
+
+} // namespace iterator_sorting
+
+#endif // ASYNC_UNIQUIFY_H
@@ -1,16 +1,49 @@
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <new>
+#include <numbers>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <tuple>
 #include <unordered_set>
 #include <variant>
 #include <vector>
 
+#include "async_uniquify.h"
+#include "hash_diagnostics.h"
 #include "hash_tuple.h"
 #include "iterator_sorting.h"
+#include "parallel_uniquify.h"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #if __has_include(<parallel_hashmap/phmap.h>)
 #include <parallel_hashmap/phmap.h>
@@ -24,195 +57,1842 @@ using Color = tuple<unsigned char, unsigned char, unsigned char>;
 using Position = tuple<double, double, double>;
 using Point3D = tuple<Position, Color>;
 
+// A point with `N` bytes of payload next to its position (e.g. normals, intensities, timestamps),
+// to measure how the element size affects index-based vs. direct sorting.
+template <size_t N>
+struct PaddedPoint
+{
+  Position pos;
+  array<unsigned char, N> payload;
+
+  auto operator<=>(const PaddedPoint &) const = default;
+};
+
+const Position & position(const Point3D & p) { return get<0>(p); }
+template <size_t N> const Position & position(const PaddedPoint<N> & p) { return p.pos; }
+
+// Every engine is instantiated per element type and key, which dominates the build time.
+// By default only `Point3D` is built (by position and as `_whole`); `-DBENCH_FULL` adds the
+// `PaddedPoint` element types of `--payload`.
+#ifdef BENCH_FULL
+constexpr bool benchFull = true;
+#else
+constexpr bool benchFull = false;
+#endif
+
+// Payload sizes accepted by `--payload`; 0 stands for `Point3D` (3 bytes of color).
+const vector<size_t> payloadSizes = benchFull ? vector<size_t>{ 0, 32, 64, 128, 256, 1024 } : vector<size_t>{ 0 };
+
+// Calls `f(type_identity<T>())` with the element type for `payload` bytes.
+template <typename F>
+void
+withElementType(size_t payload, F f)
+{
+  switch (payload) {
+    case 0: return f(type_identity<Point3D>());
+#ifdef BENCH_FULL
+    case 32: return f(type_identity<PaddedPoint<32>>());
+    case 64: return f(type_identity<PaddedPoint<64>>());
+    case 128: return f(type_identity<PaddedPoint<128>>());
+    case 256: return f(type_identity<PaddedPoint<256>>());
+    case 1024: return f(type_identity<PaddedPoint<1024>>());
+#endif
+  }
+  throw invalid_argument("unsupported payload size " + to_string(payload));
+}
+
+// Converts generated points to `T`, filling the payload from the color,
+// so that elements equal as `Point3D` are equal as `T`.
+template <typename T>
+vector<T>
+convertCloud(const vector<Point3D> & cloud)
+{
+  if constexpr (is_same_v<T, Point3D>) {
+    return cloud;
+  } else {
+    vector<T> converted(cloud.size());
+    for (size_t i = 0; i < cloud.size(); ++i) {
+      converted[i].pos = get<0>(cloud[i]);
+      const Color & c = get<1>(cloud[i]);
+      for (size_t b = 0; b < converted[i].payload.size(); ++b)
+        converted[i].payload[b] = b % 3 == 0 ? get<0>(c) : b % 3 == 1 ? get<1>(c) : get<2>(c);
+    }
+    return converted;
+  }
+}
+
+template <typename T>
+string
+elementTypeName()
+{
+  if constexpr (is_same_v<T, Point3D>)
+    return "Point3D (" + to_string(sizeof(T)) + " B)";
+  else
+    return "PaddedPoint<" + to_string(sizeof(T) - sizeof(Position)) + "> (" + to_string(sizeof(T)) + " B)";
+}
+
+
+// Prints how evenly the hash functions used by the hash-based columns
+// distribute the positions of `cloud`.
+void
+printHashDiagnostics(const vector<Point3D> & cloud)
+{
+  const auto pos = [](const Point3D & p) -> const Position & { return get<0>(p); };
+  cout << "Hash diagnostics (hash_tuple::hash):" << endl;
+  hash_diagnostics::print_hash_report(cout, hash_diagnostics::analyse_hash(cloud.begin(), cloud.end(), hash_tuple::hash<Position>(), pos));
+  cout << "Hash diagnostics (hash_tuple::legacy::hash):" << endl;
+  hash_diagnostics::print_hash_report(cout, hash_diagnostics::analyse_hash(cloud.begin(), cloud.end(), hash_tuple::legacy::hash<Position>(), pos));
+}
+
+
+// Overwrites a stretch of the stack below the caller's frame with `fill`.
+[[gnu::noinline]] void
+fillStack(unsigned char fill)
+{
+  volatile unsigned char scratch[4096];
+  for (size_t i = 0; i < sizeof(scratch); ++i)
+    scratch[i] = fill;
+}
+
+template <typename T>
+[[gnu::noinline]] size_t
+hashNoinline(const T & value)
+{
+  return hash_tuple::hash<T>()(value);
+}
+
+// Returns whether `hash_tuple::hash` of `value` stays the same when computed over
+// a stack filled with other bytes (which padding in temporaries picks up), and for
+// copies of `value` with one byte inverted that still compare equal to it
+// (copies with other padding bytes, or zero with the other sign).
+// `T` must be copyable bytewise, like tuples of arithmetic types.
+template <typename T>
+bool
+hashIgnoresRepresentation(const T & value)
+{
+  fillStack(0x00);
+  const size_t h = hashNoinline(value);
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    alignas(T) unsigned char storage[sizeof(T)];
+    memcpy(storage, static_cast<const void *>(&value), sizeof(T));
+    storage[i] ^= 0xff;
+    const T & copy = *std::launder(reinterpret_cast<const T *>(storage));
+    fillStack(0xff);
+    if (copy == value && hashNoinline(copy) != h)
+      return false;
+  }
+  return true;
+}
+
+// For `--verify`: checks that `hash_tuple::hash` is a function of values, not of their bytes.
+// Appends a description of each failed check to `mismatches`; returns the number of checks.
+size_t
+verifyHashes(vector<string> & mismatches)
+{
+  size_t numChecks = 0;
+  const auto check = [&](const string & name, bool ok) {
+    ++numChecks;
+    if (!ok)
+      mismatches.push_back("hash_tuple::hash<" + name + ">: equal values hash differently");
+  };
+  check("Position", hashIgnoresRepresentation(Position{1.5, -2, 3}));
+  check("Point3D", hashIgnoresRepresentation(Point3D{{1.5, -2, 3}, {1, 2, 3}}));
+  check("tuple<float, char, double>", hashIgnoresRepresentation(tuple<float, char, double>{1.5f, 'x', 3}));
+  check("tuple<long double, int>", hashIgnoresRepresentation(tuple<long double, int>{1.5L, 7}));
+  check("Position", hash_tuple::hash<Position>()({0.0, 1, 2}) == hash_tuple::hash<Position>()({-0.0, 1, 2}));
+  return numChecks;
+}
+
+
+// Splits "a,b,c" into its parts.
+vector<string>
+splitList(const string & s, char sep = ',')
+{
+  vector<string> parts;
+  size_t start = 0;
+  for (size_t pos; (pos = s.find(sep, start)) != string::npos; start = pos + 1)
+    parts.push_back(s.substr(start, pos - start));
+  parts.push_back(s.substr(start));
+  return parts;
+}
+
+
+// Parameters of a generated input distribution.
+// Generation is deterministic for a given spec, seed and size. It uses only
+// `mt19937_64`, whose output is specified, and no `std::` distributions, so
+// uniform and increasing positions with uniformly chosen repeats are the same
+// on any platform. Clustered positions and Zipf-distributed repeats use
+// `log`, `cos` and `pow`, which are not correctly rounded in every math library;
+// those inputs are only reproducible with the same toolchain and libm.
+struct DatasetSpec
+{
+  string preset = "increasing"; // name of the preset the parameters started from
+  double dupFraction = 0;       // fraction of elements that repeat an earlier value
+  size_t cardinality = 0;       // number of distinct values; 0: derived from `dupFraction`
+  double zipf = 0;              // exponent of the (approximately) Zipf-distributed choice of repeated values; 0: uniform
+  string order = "shuffled";    // generated (distinct values first, in generation order), shuffled, sorted, reversed
+  string positions = "uniform"; // uniform (in the unit cube), clustered (small Gaussian clusters), increasing (x only, y = z = 0)
+  size_t runLength = 1;         // each element is repeated this many times in a row (adjacent repeats)
+  uint64_t seed = 1;
+
+  // The preset name with all parameters, accepted by `parseDatasetSpec()`.
+  string
+  describe() const
+  {
+    ostringstream os;
+    os << preset << ":dup=" << dupFraction << ",card=" << cardinality << ",zipf=" << zipf << ",order=" << order
+       << ",positions=" << positions << ",run=" << runLength << ",seed=" << seed;
+    return os.str();
+  }
+};
+
+
+// Named starting points for `--dataset`.
+const vector<pair<string, DatasetSpec>> datasetPresets = [] {
+  vector<pair<string, DatasetSpec>> presets;
+  const auto add = [&presets](const string & name, auto modify) {
+    DatasetSpec spec;
+    spec.preset = name;
+    modify(spec);
+    presets.emplace_back(name, spec);
+  };
+  // Strictly increasing x, y = z = 0, no duplicates (the original benchmark input).
+  add("increasing", [](DatasetSpec & s) { s.positions = "increasing"; s.order = "generated"; });
+  add("unique", [](DatasetSpec &) {});
+  add("dup10", [](DatasetSpec & s) { s.dupFraction = 0.1; });
+  add("dup50", [](DatasetSpec & s) { s.dupFraction = 0.5; });
+  add("dup90", [](DatasetSpec & s) { s.dupFraction = 0.9; });
+  // Few distinct values, which fit into the CPU cache.
+  add("smallset", [](DatasetSpec & s) { s.cardinality = 1000; });
+  add("zipf", [](DatasetSpec & s) { s.dupFraction = 0.5; s.zipf = 1.0; });
+  add("sorted", [](DatasetSpec & s) { s.dupFraction = 0.1; s.order = "sorted"; });
+  add("reversed", [](DatasetSpec & s) { s.dupFraction = 0.1; s.order = "reversed"; });
+  add("clustered", [](DatasetSpec & s) { s.dupFraction = 0.1; s.positions = "clustered"; });
+  add("adjacent", [](DatasetSpec & s) { s.runLength = 4; });
+  return presets;
+}();
+
+
+// Parses `PRESET[:key=value,...]`, with the keys of `DatasetSpec::describe()`.
+DatasetSpec
+parseDatasetSpec(const string & text)
+{
+  const size_t colon = text.find(':');
+  const string presetName = text.substr(0, colon);
+  const auto preset = std::find_if(datasetPresets.begin(), datasetPresets.end(), [&](const auto & p) { return p.first == presetName; });
+  if (preset == datasetPresets.end())
+    throw invalid_argument("unknown dataset " + presetName);
+  DatasetSpec spec = preset->second;
+  if (colon == string::npos)
+    return spec;
+
+  for (const string & assignment : splitList(text.substr(colon + 1))) {
+    const size_t eq = assignment.find('=');
+    if (eq == string::npos) throw invalid_argument("dataset parameter needs key=value: " + assignment);
+    const string key = assignment.substr(0, eq);
+    const string value = assignment.substr(eq + 1);
+    if (key == "dup") spec.dupFraction = stod(value);
+    else if (key == "card") spec.cardinality = (size_t) round(stod(value));
+    else if (key == "zipf") spec.zipf = stod(value);
+    else if (key == "order") spec.order = value;
+    else if (key == "positions") spec.positions = value;
+    else if (key == "run") spec.runLength = std::max<size_t>(1, stoul(value));
+    else if (key == "seed") spec.seed = stoull(value);
+    else throw invalid_argument("unknown dataset parameter " + key);
+  }
+  if (spec.dupFraction < 0 || spec.dupFraction >= 1) throw invalid_argument("dataset dup must be in [0, 1)");
+  if (spec.order != "generated" && spec.order != "shuffled" && spec.order != "sorted" && spec.order != "reversed")
+    throw invalid_argument("unknown dataset order " + spec.order);
+  if (spec.positions != "uniform" && spec.positions != "clustered" && spec.positions != "increasing")
+    throw invalid_argument("unknown dataset positions " + spec.positions);
+  return spec;
+}
+
+
+// Platform-independent random numbers on top of `mt19937_64`.
+class DatasetRng
+{
+public:
+  explicit DatasetRng(uint64_t seed) : gen_(seed) {}
+
+  // Uniform in [0, 1).
+  double uniform() { return (double) (gen_() >> 11) * 0x1p-53; }
+
+  // Uniform in [0, bound), without modulo bias worth mentioning for bound << 2^64.
+  size_t below(size_t bound) { return (size_t) (((unsigned __int128) gen_() * bound) >> 64); }
+
+  // Standard normal (Box-Muller).
+  double
+  normal()
+  {
+    const double u1 = 1.0 - uniform(); // (0, 1]
+    const double u2 = uniform();
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * std::numbers::pi * u2);
+  }
+
+  unsigned char byte() { return (unsigned char) (gen_() >> 56); }
+
+private:
+  mt19937_64 gen_;
+};
+
+
+// Generates `n` points distributed according to `spec`.
+//
+// 1. `d` distinct points are generated (`d` from `cardinality`, or from `dupFraction`).
+// 2. The remaining elements repeat one of them, chosen uniformly or Zipf-distributed
+//    (rank `r`, starting at 1, with probability about proportional to `1 / r^zipf`).
+// 3. The elements are ordered, and finally each is repeated `runLength` times in a row.
+vector<Point3D>
+generateDataset(const DatasetSpec & spec, size_t n)
+{
+  DatasetRng rng(spec.seed);
+  const size_t m = (n + spec.runLength - 1) / spec.runLength; // elements before repeating them in runs
+  const size_t d = m == 0 ? 0 : std::clamp<size_t>(spec.cardinality != 0 ? spec.cardinality : m - (size_t) round((double) m * spec.dupFraction), 1, m);
+
+  vector<Point3D> base;
+  base.reserve(m);
+  if (spec.positions == "increasing") {
+    double x = 0;
+    for (size_t i = 0; i < d; ++i) {
+      x += 0.00000001;
+      base.push_back({{x, 0, 0}, {}});
+    }
+  } else if (spec.positions == "clustered") {
+    // About 1000 points per cluster, each with a standard deviation of 1/1000 of the unit cube.
+    const size_t numClusters = std::max<size_t>(1, d / 1000);
+    vector<Position> centres(numClusters);
+    for (Position & c : centres)
+      c = {rng.uniform(), rng.uniform(), rng.uniform()};
+    for (size_t i = 0; i < d; ++i) {
+      const Position & c = centres[rng.below(numClusters)];
+      base.push_back({{get<0>(c) + 0.001 * rng.normal(), get<1>(c) + 0.001 * rng.normal(), get<2>(c) + 0.001 * rng.normal()}, {rng.byte(), rng.byte(), rng.byte()}});
+    }
+  } else {
+    for (size_t i = 0; i < d; ++i)
+      base.push_back({{rng.uniform(), rng.uniform(), rng.uniform()}, {rng.byte(), rng.byte(), rng.byte()}});
+  }
+
+  // Repeats, as copies of whole points.
+  for (size_t i = d; i < m; ++i) {
+    size_t r;
+    if (spec.zipf == 0) {
+      r = rng.below(d);
+    } else {
+      // Inverse CDF of the continuous power law on [1, d + 1).
+      const double u = rng.uniform();
+      const double s = spec.zipf;
+      const double x = s == 1 ? pow((double) d + 1, u) : pow(1 + u * (pow((double) d + 1, 1 - s) - 1), 1 / (1 - s));
+      r = std::min(d - 1, (size_t) x - 1);
+    }
+    base.push_back(base[r]);
+  }
+
+  if (spec.order == "shuffled") {
+    for (size_t i = m; i > 1; --i)
+      std::swap(base[i - 1], base[rng.below(i)]);
+  } else if (spec.order == "sorted") {
+    std::sort(base.begin(), base.end());
+  } else if (spec.order == "reversed") {
+    std::sort(base.begin(), base.end(), std::greater<>());
+  }
+
+  vector<Point3D> cloud;
+  cloud.reserve(n);
+  for (size_t i = 0; i < n; ++i)
+    cloud.push_back(base[i / spec.runLength]);
+  return cloud;
+}
+
+
+// Value of the first line starting with `key` in a `/proc` file like `/proc/cpuinfo`,
+// after the `:`; empty if not found.
+string
+procField(const string & path, const string & key)
+{
+  ifstream in(path);
+  for (string line; getline(in, line); ) {
+    if (line.compare(0, key.size(), key) != 0) continue;
+    const size_t colon = line.find(':');
+    if (colon == string::npos) continue;
+    const size_t begin = line.find_first_not_of(" \t", colon + 1);
+    return begin == string::npos ? "" : line.substr(begin);
+  }
+  return "";
+}
+
+// Counting global allocator: `operator new` and `operator delete` keep track of
+// the heap bytes currently allocated and their peak, so that `BenchRun` can report
+// how much memory each algorithm allocates on top of its input.
+// Sizes come from `malloc_usable_size()`, so counting needs glibc;
+// elsewhere `heapCounting` is false and the default operators are used.
+#if defined(__GLIBC__)
+constexpr bool heapCounting = true;
+#else
+constexpr bool heapCounting = false;
+#endif
+
+atomic<size_t> heapBytes{0};
+atomic<size_t> heapPeakBytes{0};
+
+#if defined(__GLIBC__)
+void
+countAllocation(void * p)
+{
+  const size_t size = malloc_usable_size(p);
+  const size_t now = heapBytes.fetch_add(size, memory_order_relaxed) + size;
+  size_t peak = heapPeakBytes.load(memory_order_relaxed);
+  while (now > peak && !heapPeakBytes.compare_exchange_weak(peak, now, memory_order_relaxed)) {}
+}
 
 void
-benchmarkUniquify(size_t n)
+countDeallocation(void * p)
+{
+  if (p) heapBytes.fetch_sub(malloc_usable_size(p), memory_order_relaxed);
+}
+
+// The other forms (arrays, `nothrow`) forward to these.
+void *
+operator new(size_t size)
+{
+  void * p = malloc(size != 0 ? size : 1);
+  if (!p) throw bad_alloc();
+  countAllocation(p);
+  return p;
+}
+
+void *
+operator new(size_t size, align_val_t align)
 {
-  cout << "Initing vector, n = " << ((double) n) << " ..." << endl;
-  vector<Point3D> inputCloud(n);
+  const size_t a = static_cast<size_t>(align);
+  void * p = aligned_alloc(a, (std::max<size_t>(size, 1) + a - 1) / a * a);
+  if (!p) throw bad_alloc();
+  countAllocation(p);
+  return p;
+}
+
+void
+operator delete(void * p) noexcept
+{
+  countDeallocation(p);
+  free(p);
+}
+
+void
+operator delete(void * p, align_val_t) noexcept
+{
+  countDeallocation(p);
+  free(p);
+}
+
+void operator delete(void * p, size_t) noexcept { operator delete(p); }
+void operator delete(void * p, size_t, align_val_t align) noexcept { operator delete(p, align); }
+#endif
+
+// Resets the peak resident set size (`VmHWM`) of this process to the current one.
+// Returns false if the kernel does not allow it (Linux before 4.0, or no /proc).
+bool
+resetPeakRss()
+{
+  ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5" << flush;
+  return clearRefs.good();
+}
+
+// Current (`VmRSS`) or peak (`VmHWM`) resident set size in bytes; 0 if unknown.
+size_t
+rssBytes(const string & field)
+{
+  const string kb = procField("/proc/self/status", field);
+  return kb.empty() ? 0 : stoull(kb) * 1024;
+}
+
+
+// Hardware (and a software) performance counters for `--perf`, from `perf_event_open()`.
+// Each event is opened separately, so those the CPU, kernel or permissions
+// (`/proc/sys/kernel/perf_event_paranoid`) do not allow are simply missing.
+// Counters are inherited by threads created after opening, so the
+// scheduler's workers are included if `perfCounters()` is called before
+// the scheduler is first used. Values are scaled for multiplexing.
+struct PerfEvent
+{
+  const char * name;    // as in the JSON and CSV output
+  const char * heading; // in the printed table, per element
+};
+
+constexpr array<PerfEvent, 6> perfEvents = {{
+  {"cycles", "cycles"},
+  {"instructions", "instr"},
+  {"cache_misses", "LLC-miss"},
+  {"dtlb_misses", "dTLB-miss"},
+  {"branch_misses", "br-miss"},
+  {"page_faults", "pg-fault"},
+}};
+
+using PerfValues = array<double, perfEvents.size()>; // per event; NAN: not available
+
+class PerfCounters
+{
+public:
+  PerfCounters()
+  {
+    fds_.fill(-1);
+#if defined(__linux__)
+    const uint64_t dtlbReadMiss = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    const array<pair<uint32_t, uint64_t>, perfEvents.size()> configs = {{
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+      {PERF_TYPE_HW_CACHE, dtlbReadMiss},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+      {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    }};
+    for (size_t e = 0; e < perfEvents.size(); ++e) {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof attr);
+      attr.size = sizeof attr;
+      attr.type = configs[e].first;
+      attr.config = configs[e].second;
+      attr.disabled = 1;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds_[e] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+      if (fds_[e] < 0 && error_.empty())
+        error_ = string(perfEvents[e].name) + ": " + strerror(errno);
+    }
+#else
+    error_ = "perf_event_open() needs Linux";
+#endif
+  }
+
+  ~PerfCounters()
+  {
+#if defined(__linux__)
+    for (const int fd : fds_)
+      if (fd >= 0) close(fd);
+#endif
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters & operator=(const PerfCounters &) = delete;
+
+  bool
+  anyAvailable() const
   {
-    cout << "Generating vector..." << endl;
-    std::generate(inputCloud.begin(), inputCloud.end(), [n = 0.0] () mutable -> Point3D { n += 0.00000001; return {{n, 0, 0}, {}}; });
+    return std::any_of(fds_.begin(), fds_.end(), [](int fd) { return fd >= 0; });
   }
 
-  double duration_stable_unique_iterators;
-  double duration_stable_unique_iterators_whole;
-  double duration_unstable_unique_iterators;
-  double duration_direct_vector_stable_sort;
-  double duration_direct_vector_stable_sort_whole;
-  double duration_direct_vector_unstable_sort;
-  double duration_direct_vector_unstable_sort_whole;
-  double duration_unordered_set;
+  // Why the first unavailable event could not be opened; empty if all are available.
+  const string & error() const { return error_; }
+
+  // Names of the events that could not be opened.
+  string
+  missing() const
+  {
+    string names;
+    for (size_t e = 0; e < perfEvents.size(); ++e)
+      if (fds_[e] < 0) names += (names.empty() ? "" : ", ") + string(perfEvents[e].name);
+    return names;
+  }
+
+  void
+  start()
+  {
+#if defined(__linux__)
+    for (const int fd : fds_) {
+      if (fd < 0) continue;
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  // Stops counting and returns the counts since `start()`.
+  PerfValues
+  stop()
+  {
+    PerfValues values;
+    values.fill(NAN);
+#if defined(__linux__)
+    for (const int fd : fds_)
+      if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    for (size_t e = 0; e < perfEvents.size(); ++e) {
+      uint64_t data[3]; // value, time enabled, time running
+      if (fds_[e] < 0 || ::read(fds_[e], data, sizeof data) != (ssize_t) sizeof data) continue;
+      values[e] = data[2] == 0 ? 0.0 : (double) data[0] * ((double) data[1] / (double) data[2]);
+    }
+#endif
+    return values;
+  }
+
+private:
+  array<int, perfEvents.size()> fds_;
+  string error_;
+};
+
+// The counters used by `--perf`, opened on first use.
+PerfCounters &
+perfCounters()
+{
+  static PerfCounters counters;
+  return counters;
+}
+
+
+// Cache state before each timed run, for `--cold`.
+enum class ColdMode
+{
+  none,  // warm only: the input was just copied, so small inputs are in cache
+  llc,   // also cold: a buffer larger than the last-level cache is written before each run
+  input, // also cold: the input's cache lines are flushed (as if it had just arrived by DMA or from disk)
+};
+
+// Size of the last-level cache, or 64 MiB if unknown.
+size_t
+lastLevelCacheBytes()
+{
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+  const long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if (l3 > 0) return (size_t) l3;
+#endif
+  ifstream in("/sys/devices/system/cpu/cpu0/cache/index3/size"); // e.g. "32768K"
+  size_t kb = 0;
+  if (in >> kb) return kb * 1024;
+  return 64 << 20;
+}
+
+// Evicts the caches by writing a buffer of twice the last-level cache size
+// (at least 8 MiB, at most 1 GiB). Returns how long that took, in seconds.
+double
+evictCaches()
+{
+  static vector<unsigned char> buffer(std::clamp<size_t>(2 * lastLevelCacheBytes(), 8 << 20, 1 << 30));
+  const auto t0 = chrono::steady_clock::now();
+  for (size_t i = 0; i < buffer.size(); i += 64)
+    ++buffer[i];
+  return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+// Flushes the cache lines of `v`'s elements to memory (x86: `clflush`; elsewhere: `evictCaches()`).
+template <typename T>
+void
+flushFromCaches(const vector<T> & v)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  const char * begin = reinterpret_cast<const char *>(v.data());
+  const char * end = begin + v.size() * sizeof(T);
+  for (const char * line = begin - (reinterpret_cast<uintptr_t>(begin) & 63); line < end; line += 64)
+    _mm_clflush(line);
+  _mm_mfence();
+#else
+  evictCaches();
+#endif
+}
+
+
+// Benchmark settings, from the command line.
+struct BenchOptions
+{
+  vector<size_t> sizes;              // input sizes to run; default: 1000 to 100M in sqrt(10) steps
+  vector<string> algos;              // names of algorithms to run (`prefix*` matches by prefix); empty: all
+  size_t reps = 0;                   // timed runs per algorithm and size; 0: as many as fit into `budget`
+  double budget = 1.0;               // seconds of timed runs per algorithm and size, if `reps` is 0
+  size_t maxReps = 1000;             // upper bound for the repetitions derived from `budget`
+  size_t threads = 0;                // threads of the library scheduler; 0: all hardware threads
+  vector<DatasetSpec> datasets;      // input distributions; default: `increasing`
+  vector<size_t> payloads = {0};     // element types to run, see `payloadSizes`
+  string jsonPath;                   // write all results as JSON to this file, if set
+  string csvPath;                    // write all results as CSV to this file, if set
+  string commandLine;                // recorded in the JSON output
+  bool perf = false;                 // read performance counters around the timed runs
+  bool verify = false;               // check every algorithm's output against a reference
+  ColdMode cold = ColdMode::none;    // also time each algorithm with cold caches
+  string simdLevel;                  // force this `iterator_sorting::simd_level` by name; empty: the detected one
+  bool hashDiagnostics = false;
+  bool asyncExample = false;
+};
+
+
+// Summary statistics of repeated timings, in seconds.
+struct TimingStats
+{
+  size_t reps = 0;
+  double min = 0;
+  double median = 0;
+  double p90 = 0;    // 90th percentile (nearest rank)
+  double mean = 0;
+  double stddev = 0; // sample standard deviation; 0 for a single run
+};
+
+
+TimingStats
+computeStats(vector<double> samples)
+{
+  TimingStats st;
+  st.reps = samples.size();
+  if (samples.empty()) return st;
+  std::sort(samples.begin(), samples.end());
+  const size_t n = samples.size();
+  st.min = samples.front();
+  st.median = n % 2 == 1 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+  st.p90 = samples[(size_t) ceil(0.9 * (double) n) - 1];
+  double sum = 0;
+  for (const double x : samples) sum += x;
+  st.mean = sum / (double) n;
+  double squares = 0;
+  for (const double x : samples) squares += (x - st.mean) * (x - st.mean);
+  st.stddev = n > 1 ? sqrt(squares / (double) (n - 1)) : 0;
+  return st;
+}
+
+
+// What an algorithm's output must be, for `--verify`.
+struct Expectation
+{
+  enum class Kept
+  {
+    first,             // the first occurrence of each distinct value
+    any,               // some occurrence of each distinct value
+    firstInFirstHalf,  // first occurrences in the first half (`unique_intersection()` vs. the first half)
+    firstInSecondHalf, // first occurrences in the second half (`unique_difference()` vs. the first half)
+  };
+  enum class Order { input, sorted };
+
+  Kept kept;
+  Order order;
+  bool whole; // distinct by whole element, not by position
+};
+
+// Checks algorithm outputs on `input` against a simple reference (first occurrences found with `std::set`),
+// independent of the library's sorting, hashing and SIMD code.
+template <typename T>
+class OutputChecker
+{
+public:
+  explicit OutputChecker(const vector<T> & input)
+    : input_(input)
+  {}
+
+  // Returns how the surviving elements `survivors` (in output order), with their
+  // input indices `indices` if known (else null), deviate from `e`; empty if they match.
+  // Some occurrence of each value in input order (`Kept::any` with `Order::input`) means
+  // increasing indices, and is otherwise compared in sorted order.
+  string
+  check(const Expectation & e, vector<T> survivors, const vector<size_t> * indices)
+  {
+    const auto equal = [&e](const T & a, const T & b) { return e.whole ? a == b : position(a) == position(b); };
+    const auto less = [&e](const T & a, const T & b) { return e.whole ? a < b : position(a) < position(b); };
+
+    vector<size_t> expected;
+    const size_t half = input_.size() / 2;
+    for (const size_t i : firstOccurrences(e.whole)) {
+      if (e.kept == Expectation::Kept::firstInFirstHalf && i >= half) continue;
+      if (e.kept == Expectation::Kept::firstInSecondHalf && i < half) continue;
+      expected.push_back(i);
+    }
+    if (e.kept == Expectation::Kept::any && e.order == Expectation::Order::input) {
+      for (size_t p = 1; indices && p < indices->size(); ++p) {
+        if ((*indices)[p - 1] >= (*indices)[p])
+          return "at output position " + to_string(p) + ": indices not increasing";
+      }
+      std::sort(survivors.begin(), survivors.end(), less);
+      indices = nullptr; // no longer in output order; the values are checked below
+    }
+    if (e.order == Expectation::Order::sorted || e.kept == Expectation::Kept::any)
+      std::sort(expected.begin(), expected.end(), [&](size_t a, size_t b) { return less(input_[a], input_[b]); });
+
+    if (survivors.size() != expected.size())
+      return "got " + to_string(survivors.size()) + " uniques, expected " + to_string(expected.size());
+    for (size_t p = 0; p < expected.size(); ++p) {
+      const T & want = input_[expected[p]];
+      const string at = "at output position " + to_string(p) + ": ";
+      if (indices && (*indices)[p] >= input_.size())
+        return at + "index " + to_string((*indices)[p]) + " out of range";
+      if (e.kept != Expectation::Kept::any) {
+        if (indices && (*indices)[p] != expected[p])
+          return at + "index " + to_string((*indices)[p]) + ", expected " + to_string(expected[p]);
+        if (!indices && !(survivors[p] == want))
+          return at + "element differs from the expected input[" + to_string(expected[p]) + "]";
+      } else {
+        if (!equal(survivors[p], want))
+          return at + "value differs from the expected one, input[" + to_string(expected[p]) + "]";
+        if (!isInputElement(survivors[p]))
+          return at + "element is not in the input (corrupted while moving?)";
+      }
+    }
+    return "";
+  }
+
+private:
+  // Input indices of the first occurrence of each distinct value, in input order.
+  const vector<size_t> &
+  firstOccurrences(bool whole)
+  {
+    vector<size_t> & first = whole ? firstWhole_ : firstPosition_;
+    bool & computed = whole ? computedWhole_ : computedPosition_;
+    if (!computed) {
+      const auto less = [this, whole](size_t a, size_t b) {
+        return whole ? input_[a] < input_[b] : position(input_[a]) < position(input_[b]);
+      };
+      set<size_t, decltype(less)> seen(less);
+      for (size_t i = 0; i < input_.size(); ++i)
+        if (seen.insert(i).second) first.push_back(i);
+      computed = true;
+    }
+    return first;
+  }
+
+  bool
+  isInputElement(const T & x)
+  {
+    if (sortedInput_.size() != input_.size()) {
+      sortedInput_.resize(input_.size());
+      for (size_t i = 0; i < input_.size(); ++i) sortedInput_[i] = i;
+      std::sort(sortedInput_.begin(), sortedInput_.end(), [this](size_t a, size_t b) { return input_[a] < input_[b]; });
+    }
+    const auto it = std::lower_bound(sortedInput_.begin(), sortedInput_.end(), x, [this](size_t a, const T & b) { return input_[a] < b; });
+    return it != sortedInput_.end() && input_[*it] == x;
+  }
+
+  const vector<T> & input_;
+  vector<size_t> firstPosition_;
+  vector<size_t> firstWhole_;
+  bool computedPosition_ = false;
+  bool computedWhole_ = false;
+  vector<size_t> sortedInput_; // indices of `input_` sorted by whole element
+};
+
+
+// Runs and times the algorithms selected by the options on one input,
+// and collects their timings for printing.
+template <typename T>
+class BenchRun
+{
+public:
+  BenchRun(const vector<T> & input, const BenchOptions & options)
+    : input_(input)
+    , options_(options)
+    , checker_(input)
+  {}
+
+  // Whether `name` passes the `--algos` filter. `NAME@LEVEL` (see `measureEngine()`)
+  // also passes if `NAME` does.
+  bool
+  selected(const string & name) const
+  {
+    if (options_.algos.empty()) return true;
+    const string base = name.substr(0, name.find('@'));
+    for (const string & pattern : options_.algos) {
+      if (pattern == name || pattern == base) return true;
+      if (!pattern.empty() && pattern.back() == '*' && name.compare(0, pattern.size() - 1, pattern, 0, pattern.size() - 1) == 0) return true;
+    }
+    return false;
+  }
+
+  // Times `run(v)` on fresh copies `v` of the input, after untimed `prepare(v)`.
+  // `run` returns either the number of uniques, which it left at the front of `v`,
+  // or iterators into `v` to the uniques. `note` is printed next to the name.
+  // With `--verify`, the output of the warm-up run is checked against `expect`.
+  // One untimed warm-up run comes first; its duration also determines how
+  // many timed runs fit into the time budget, unless `--reps` is given.
+  // Also records the peak heap bytes allocated by `run` (over all runs), and the growth of
+  // the peak resident set size during the warm-up run, which includes stack and
+  // memory not from `operator new`, but misses pages that the allocator reuses.
+  // With `--perf`, also averages the performance counters over the timed runs.
+  // With `--cold`, the timed runs are repeated with the caches evicted before each
+  // (`evictCaches()`) or the input flushed from them (`flushFromCaches()`).
+  template <typename Prepare, typename Run>
+  void
+  measure(const string & name, const string & note, const Expectation & expect, Prepare prepare, Run run)
+  {
+    if (!selected(name)) return;
+    cout << name << "..." << endl;
+    double peakHeap = heapCounting ? 0 : NAN;
+    double peakRss = NAN;
+    PerfValues perfSum;
+    perfSum.fill(options_.perf ? 0.0 : NAN);
+    string mismatch;
+    const auto timedRun = [&](size_t & numUniques, bool sampleRss, bool countPerf, bool cold) {
+      vector<T> v = input_; // copy
+      prepare(v);
+      if (cold && options_.cold == ColdMode::llc) evictCaches();
+      if (cold && options_.cold == ColdMode::input) flushFromCaches(v);
+      const bool rssReset = sampleRss && resetPeakRss();
+      const size_t rssBefore = rssReset ? rssBytes("VmRSS") : 0;
+      const size_t heapBefore = heapBytes.load(memory_order_relaxed);
+      heapPeakBytes.store(heapBefore, memory_order_relaxed);
+      if (countPerf) perfCounters().start();
+      const auto t0 = chrono::steady_clock::now();
+      const auto output = run(v);
+      const auto t1 = chrono::steady_clock::now();
+      if (countPerf) {
+        const PerfValues counts = perfCounters().stop();
+        for (size_t e = 0; e < counts.size(); ++e)
+          perfSum[e] += counts[e];
+      }
+      if (heapCounting)
+        peakHeap = std::max(peakHeap, (double) (heapPeakBytes.load(memory_order_relaxed) - heapBefore));
+      const size_t rssPeak = rssReset ? rssBytes("VmHWM") : 0;
+      if (rssPeak != 0)
+        peakRss = (double) (rssPeak - std::min(rssPeak, rssBefore));
+
+      const bool verify = sampleRss && options_.verify; // the warm-up run
+      if constexpr (is_same_v<decltype(output), const size_t>) {
+        numUniques = output;
+        if (verify)
+          mismatch = checker_.check(expect, vector<T>(v.begin(), v.begin() + (ptrdiff_t) std::min(output, v.size())), nullptr);
+      } else {
+        numUniques = output.size();
+        if (verify) {
+          vector<T> survivors;
+          vector<size_t> indices;
+          for (const auto it : output) {
+            indices.push_back((size_t) (it - v.begin()));
+            survivors.push_back(indices.back() < v.size() ? *it : T());
+          }
+          mismatch = checker_.check(expect, survivors, &indices);
+        }
+      }
+      return chrono::duration<double>(t1 - t0).count();
+    };
+
+    size_t numUniques = 0;
+    const double warmup = timedRun(numUniques, true, false, false);
+    size_t reps = options_.reps;
+    if (reps == 0)
+      reps = (size_t) std::clamp(options_.budget / std::max(warmup, 1e-9), 1.0, (double) options_.maxReps);
+    vector<double> samples;
+    samples.reserve(reps);
+    for (size_t rep = 0; rep < reps; ++rep)
+      samples.push_back(timedRun(numUniques, false, options_.perf, false));
+    PerfValues perfMean;
+    for (size_t e = 0; e < perfSum.size(); ++e)
+      perfMean[e] = perfSum[e] / (double) reps;
+
+    vector<double> coldSamples;
+    if (options_.cold != ColdMode::none) {
+      // The eviction is not timed, but counts against the budget.
+      size_t coldReps = options_.reps;
+      if (coldReps == 0) {
+        const double evictTime = options_.cold == ColdMode::llc ? evictCaches() : 0;
+        coldReps = (size_t) std::clamp(options_.budget / std::max(warmup + evictTime, 1e-9), 1.0, (double) options_.maxReps);
+      }
+      for (size_t rep = 0; rep < coldReps; ++rep)
+        coldSamples.push_back(timedRun(numUniques, false, false, true));
+    }
+
+    cout << name << " done, got " << numUniques << " uniques" << endl;
+    if (!mismatch.empty())
+      cout << name << " MISMATCH: " << mismatch << endl;
+    results_.push_back({
+      name, note.empty() ? name : name + " (" + note + ")", computeStats(std::move(samples)), computeStats(std::move(coldSamples)),
+      numUniques, peakHeap, peakRss, perfMean, mismatch,
+    });
+  }
+
+  struct Result
+  {
+    string name;
+    string label;
+    TimingStats stats;
+    TimingStats coldStats; // with `--cold`; `reps` 0: not measured
+    size_t numUniques;
+    double peakHeapBytes; // NAN: not measurable here
+    double peakRssBytes;  // NAN: not measurable here
+    PerfValues perf;      // mean counts per timed run; NAN: not measured
+    string mismatch;      // how the output deviated from the expected one with `--verify`; empty: as expected
+  };
+
+  const vector<Result> & results() const { return results_; }
+
+  // Prints all timings, in milliseconds, with factors of the medians relative to the first one,
+  // and the peak extra heap and RSS bytes per input element.
+  // With `--cold`, the cold median follows, with its ratio to the warm one.
+  void
+  printTimings() const
+  {
+    if (results_.empty()) return;
+    const double ref = results_.front().stats.median; // reference time against which we compute factors
+    const double n = (double) std::max<size_t>(input_.size(), 1);
+    const auto perElement = [n](double bytes) { return isnan(bytes) ? string("-") : to_string((long long) round(bytes / n)); };
+    const bool cold = options_.cold != ColdMode::none;
+    cout << left << setw(57) << "Timing (ms), peak extra memory (B/element):" << right
+         << "    min  median     p90  stddev   reps    heap     RSS" << (cold ? "  cold median  cold/warm" : "") << endl;
+    cout << fixed << setprecision(3);
+    for (size_t i = 0; i < results_.size(); ++i) {
+      const Result & r = results_[i];
+      const TimingStats & st = r.stats;
+      cout << "  " << left << setw(55) << (r.label + ":") << right
+           << setw(7) << 1e3 * st.min << " " << setw(7) << 1e3 * st.median << " " << setw(7) << 1e3 * st.p90 << " " << setw(7) << 1e3 * st.stddev
+           << " " << setw(6) << st.reps << " " << setw(7) << perElement(r.peakHeapBytes) << " " << setw(7) << perElement(r.peakRssBytes);
+      if (cold)
+        cout << " " << setw(12) << 1e3 * r.coldStats.median << " " << setprecision(2) << setw(10) << r.coldStats.median / st.median << setprecision(3);
+      if (i != 0)
+        cout << setprecision(2) << "  (" << (st.median / ref) << " x)" << setprecision(3);
+      cout << endl;
+    }
+    cout << defaultfloat;
+  }
+
+  // Prints the `--perf` counters per input element, and instructions per cycle.
+  void
+  printCounters() const
+  {
+    if (results_.empty()) return;
+    const double n = (double) std::max<size_t>(input_.size(), 1);
+    cout << left << setw(57) << "Counters (per element):" << right;
+    for (const PerfEvent & event : perfEvents)
+      cout << setw(10) << event.heading;
+    cout << setw(7) << "IPC" << endl;
+    cout << fixed << setprecision(3);
+    for (const Result & r : results_) {
+      cout << "  " << left << setw(55) << (r.label + ":") << right;
+      for (const double count : r.perf) {
+        if (isnan(count)) cout << setw(10) << "-";
+        else cout << setw(10) << count / n;
+      }
+      const double ipc = r.perf[1] / r.perf[0];
+      if (isfinite(ipc)) cout << setw(7) << ipc;
+      else cout << setw(7) << "-";
+      cout << endl;
+    }
+    cout << defaultfloat;
+  }
+
+private:
+  const vector<T> & input_;
+  const BenchOptions & options_;
+  OutputChecker<T> checker_;
+  vector<Result> results_;
+};
+
+
+// How engines compare elements: `PositionKey` by their position (a projection),
+// `WholeKey` by the whole element (the `_whole` variants).
+// `proj`, `less`, `equal` and `hash` are stateless function objects;
+// hash sets store `value_type`s and hash them with `hash_type`.
+template <typename T>
+struct PositionKey
+{
+  static constexpr bool whole = false;
+  using value_type = Position;
+  using hash_type = hash_tuple::hash<Position>;
+  static constexpr auto proj = [](const T & x) -> const Position & { return position(x); };
+  static constexpr auto less = [](const T & a, const T & b) { return position(a) < position(b); };
+  static constexpr auto equal = [](const T & a, const T & b) { return position(a) == position(b); };
+  static constexpr auto hash = [](const T & x) { return hash_tuple::hash<Position>()(position(x)); };
+};
+
+// Hash of whole elements.
+struct WholeHash
+{
+  size_t operator()(const Point3D & p) const { return hash_tuple::hash<Point3D>()(p); }
+
+  template <size_t N>
+  size_t
+  operator()(const PaddedPoint<N> & p) const
+  {
+    return (size_t) hash_tuple::hash_bytes(p.payload.data(), N, hash_tuple::hash<Position>()(p.pos));
+  }
+};
+
+template <typename T>
+struct WholeKey
+{
+  static constexpr bool whole = true;
+  using value_type = T;
+  using hash_type = WholeHash;
+  static constexpr auto proj = std::identity();
+  static constexpr auto less = std::less<>();
+  static constexpr auto equal = std::equal_to<>();
+  static constexpr auto hash = WholeHash();
+};
+
+// All levels of the SIMD kernels, for `--simd` and `--verify`.
+constexpr array<iterator_sorting::simd_level, 4> simdLevels = {
+  iterator_sorting::simd_level::scalar, iterator_sorting::simd_level::sse2,
+  iterator_sorting::simd_level::avx2, iterator_sorting::simd_level::avx512f,
+};
+
+// What a benchmarked engine can do; the driver runs every key the engine supports.
+struct EngineCaps
+{
+  bool stable = false;     // keeps the first occurrences, in input order
+  bool projection = false; // can compare a projection (`PositionKey`)
+  bool whole = false;      // can compare whole elements (`WholeKey`)
+  bool parallel = false;   // runs on the scheduler's threads
+  bool simd = false;       // uses the SIMD kernels; `--verify` reruns it at every level the CPU supports
+};
+
+// State that an engine's `prepare` can hand to its `run`.
+template <typename T>
+struct EngineContext
+{
+  const vector<T> & input;
+  vector<size_t> sortedIndex;
+};
+
+// A benchmarked engine. `run(v, key, ctx)` deduplicates `v`, comparing by `key`, and
+// returns like the `run` of `BenchRun::measure()`; `prepare(v, key, ctx)` runs untimed before it.
+// The output is checked by `--verify` against `kept` and `order` (by default those of `caps.stable`).
+template <typename Prepare, typename Run>
+struct Engine
+{
+  string name;
+  string note;
+  EngineCaps caps;
+  Expectation::Kept kept;
+  Expectation::Order order;
+  Prepare prepare;
+  Run run;
+};
+
+constexpr auto noPrepare = [](auto &, const auto &, auto &) {};
+
+// An engine without preparation, whose output follows from `caps.stable`:
+// first occurrences in input order, or some occurrence of each value in sorted order.
+template <typename Run>
+auto
+engine(string name, EngineCaps caps, Run run)
+{
+  return Engine<decltype(noPrepare), Run>{
+    std::move(name), "", caps,
+    caps.stable ? Expectation::Kept::first : Expectation::Kept::any,
+    caps.stable ? Expectation::Order::input : Expectation::Order::sorted,
+    noPrepare, run,
+  };
+}
+
+// Hash-set deduplication: `remove_if()` with `seen.insert(x).second`, where `x` is
+// the whole element for sets of `T`, and its position for sets of `Position`.
+template <typename T, typename Set>
+size_t
+dedupWithSet(vector<T> & v, Set & seen)
+{
+  seen.reserve(v.size());
+  v.erase(std::remove_if(v.begin(), v.end(),
+    [&seen](const T & x)
+    {
+      if constexpr (is_same_v<typename Set::key_type, T>)
+        return !seen.insert(x).second; // insert().second is false if the value couldn't be inserted (is a duplicate)
+      else
+        return !seen.insert(position(x)).second;
+    }),
+    v.end()
+  );
+  return seen.size();
+}
+
+constexpr EngineCaps anyKey{.projection = true, .whole = true};
+constexpr EngineCaps stableAnyKey{.stable = true, .projection = true, .whole = true};
+constexpr EngineCaps stableAnySimdKey{.stable = true, .projection = true, .whole = true, .simd = true};
+
+// All engines benchmarked by `benchmarkUniquify()`, in table order.
+// To add one, add it here; `--algos`, `--verify`, the `_whole` variants and the outputs follow.
+auto
+uniquifyEngines()
+{
+  using Kept = Expectation::Kept;
+  using Order = Expectation::Order;
+
+  return make_tuple(
+    engine("stable_unique_iterators", stableAnyKey, [](auto & v, const auto & key, auto &) {
+      return iterator_sorting::stable_unique_iterators(v.begin(), v.end(), key.less, key.equal);
+    }),
+
+    // Sorted back into input order, keeping some occurrence of each value.
+    Engine{"unstable_unique_iterators", "", anyKey, Kept::any, Order::input, noPrepare, [](auto & v, const auto & key, auto &) {
+      return iterator_sorting::unstable_unique_iterators(v.begin(), v.end(), key.less, key.equal);
+    }},
+
+    // Kernel chosen from the key type (radix for Position).
+    engine("stable_unique_iterators_by", stableAnySimdKey, [](auto & v, const auto & key, auto &) {
+      return iterator_sorting::stable_unique_iterators_by(v.begin(), v.end(), key.proj);
+    }),
+
+    // In-place; stack buffers only for small n.
+    engine("stable_uniquify", stableAnyKey, [](auto & v, const auto & key, auto &) {
+      v.erase(iterator_sorting::stable_uniquify(v.begin(), v.end(), key.less, key.equal), v.end());
+      return v.size();
+    }),
+
+    // In-place; stack hash table for small n.
+    engine("stable_uniquify_by", stableAnySimdKey, [](auto & v, const auto & key, auto &) {
+      v.erase(iterator_sorting::stable_uniquify_by(v.begin(), v.end(), key.proj), v.end());
+      return v.size();
+    }),
+
+    engine("fingerprint_unique_iterators", stableAnyKey, [](auto & v, const auto & key, auto &) {
+      return iterator_sorting::fingerprint_unique_iterators(v.begin(), v.end(), key.hash, key.equal);
+    }),
+
+    // One chunk per scheduler thread.
+    engine("concurrent_hash_unique_iterators", {.stable = true, .projection = true, .whole = true, .parallel = true}, [](auto & v, const auto & key, auto &) {
+      return iterator_sorting::concurrent_hash_unique_iterators(v.begin(), v.end(), key.hash, key.equal);
+    }),
+
+    engine("sharded_hash_unique_iterators", {.stable = true, .projection = true, .whole = true, .parallel = true}, [](auto & v, const auto & key, auto &) {
+      return iterator_sorting::sharded_hash_unique_iterators(v.begin(), v.end(), key.hash, key.equal);
+    }),
+
+    // Index sort, then moving each element once; keeps first occurrences, in sorted order.
+    Engine{"sorted_uniquify", "", anyKey, Kept::first, Order::sorted, noPrepare, [](auto & v, const auto & key, auto &) {
+      v.erase(iterator_sorting::sorted_uniquify(v.begin(), v.end(), key.less, key.equal), v.end());
+      return v.size();
+    }},
+
+    // Adding the last 10% as a batch to the deduplicated first 90%.
+    Engine{
+      "merge_uniquify", "last 10% as batch", stableAnyKey, Kept::first, Order::input,
+      [](auto & base, const auto & key, auto & ctx) {
+        base.resize(ctx.input.size() * 9 / 10);
+        base.erase(iterator_sorting::stable_uniquify(base.begin(), base.end(), key.less, key.equal), base.end());
+        ctx.sortedIndex = iterator_sorting::sorted_indices(base, key.less);
+      },
+      [](auto & base, const auto & key, auto & ctx) {
+        const auto batchBegin = ctx.input.begin() + (ptrdiff_t) (ctx.input.size() * 9 / 10);
+        iterator_sorting::merge_uniquify(base, ctx.sortedIndex, batchBegin, ctx.input.end(), key.less, key.equal);
+        return base.size();
+      },
+    },
+
+    // Against the first half as reference.
+    Engine{"unique_difference", "vs first half", anyKey, Kept::firstInSecondHalf, Order::input, noPrepare, [](auto & v, const auto & key, auto &) {
+      const auto refEnd = v.begin() + (ptrdiff_t) (v.size() / 2);
+      return iterator_sorting::unique_difference(v.begin(), v.end(), v.begin(), refEnd, key.less, key.equal);
+    }},
+
+    Engine{"unique_intersection", "vs first half", anyKey, Kept::firstInFirstHalf, Order::input, noPrepare, [](auto & v, const auto & key, auto &) {
+      const auto refEnd = v.begin() + (ptrdiff_t) (v.size() / 2);
+      return iterator_sorting::unique_intersection(v.begin(), v.end(), v.begin(), refEnd, key.less, key.equal);
+    }},
+
+    // Direct element sorting (no indices). The stable sort keeps first occurrences, in sorted order.
+    Engine{"direct_vector_stable_sort", "", anyKey, Kept::first, Order::sorted, noPrepare, [](auto & v, const auto & key, auto &) {
+      std::stable_sort(v.begin(), v.end(), key.less);
+      v.erase(unique(v.begin(), v.end(), key.equal), v.end());
+      return v.size();
+    }},
+
+    // `iterator_sorting::unstable_uniquify()`: `std::sort` + `std::unique` in-place, no index memory.
+    engine("direct_vector_unstable_sort", anyKey, [](auto & v, const auto & key, auto &) {
+      v.erase(iterator_sorting::unstable_uniquify(v.begin(), v.end(), key.less, key.equal), v.end());
+      return v.size();
+    }),
+
+    engine("unordered_set", stableAnyKey, [](auto & v, const auto & key, auto &) {
+      unordered_set<typename decay_t<decltype(key)>::value_type, typename decay_t<decltype(key)>::hash_type> seen;
+      return dedupWithSet(v, seen);
+    }),
+
+    // With the original Boost-style hash_combine, on positions.
+    engine("unordered_set_legacy_hash", {.stable = true, .projection = true}, [](auto & v, const auto &, auto &) {
+      unordered_set<Position, hash_tuple::legacy::hash<Position>> seen;
+      return dedupWithSet(v, seen);
+    })
 #ifdef HAVE_DEPENDENCY_PHMAP
-  double duration_flat_hash_set;
+    ,
+    // With phmap's own hash, on positions.
+    engine("flat_hash_set", {.stable = true, .projection = true}, [](auto & v, const auto &, auto &) {
+      phmap::flat_hash_set<Position> seen;
+      return dedupWithSet(v, seen);
+    }),
+
+    engine("flat_hash_set_hash_tuple", stableAnyKey, [](auto & v, const auto & key, auto &) {
+      phmap::flat_hash_set<typename decay_t<decltype(key)>::value_type, typename decay_t<decltype(key)>::hash_type> seen;
+      return dedupWithSet(v, seen);
+    }),
+
+    // With the original Boost-style hash_combine, on positions, next to `flat_hash_set_hash_tuple`.
+    engine("flat_hash_set_legacy_hash", {.stable = true, .projection = true}, [](auto & v, const auto &, auto &) {
+      phmap::flat_hash_set<Position, hash_tuple::legacy::hash<Position>> seen;
+      return dedupWithSet(v, seen);
+    })
 #endif
+  );
+}
 
+// Measures `e` with `key` if it supports it; named `e.name`, with `_whole` appended for `WholeKey`.
+// With `--verify`, engines using the SIMD kernels are measured again at each other
+// level the CPU supports, named with `@LEVEL` appended.
+template <typename T, typename E, typename Key>
+void
+measureEngine(BenchRun<T> & bench, EngineContext<T> & ctx, const E & e, const Key & key, const BenchOptions & options)
+{
+  if (!(Key::whole ? e.caps.whole : e.caps.projection)) return;
+  const string name = Key::whole ? e.name + "_whole" : e.name;
+  string note = e.note;
+  if (e.caps.parallel) {
+    const string threads = to_string(iterator_sorting::default_scheduler().concurrency()) + " threads";
+    note = note.empty() ? threads : note + ", " + threads;
+  }
+  const auto measure = [&](const string & levelName) {
+    bench.measure(levelName.empty() ? name : name + "@" + levelName, note, Expectation{e.kept, e.order, Key::whole},
+      [&](vector<T> & v) { e.prepare(v, key, ctx); },
+      [&](vector<T> & v) { return e.run(v, key, ctx); });
+  };
+  measure("");
+
+  if (!(options.verify && e.caps.simd)) return;
+  const iterator_sorting::simd_level active = iterator_sorting::active_simd_level();
+  for (const iterator_sorting::simd_level level : simdLevels) {
+    if (level == active || level > iterator_sorting::detect_simd_level()) continue;
+    iterator_sorting::set_simd_level(level);
+    measure(iterator_sorting::simd_level_name(level));
+  }
+  iterator_sorting::set_simd_level(active);
+}
+
+
+// Runs all selected engines of `uniquifyEngines()` with every key they support
+// on `inputCloud`, and returns their timings.
+template <typename T>
+vector<typename BenchRun<T>::Result>
+benchmarkUniquify(const vector<T> & inputCloud, const BenchOptions & options)
+{
+  BenchRun<T> bench(inputCloud, options);
+  EngineContext<T> ctx{inputCloud, {}};
+
+  std::apply([&](const auto & ... engines) {
+    ((measureEngine(bench, ctx, engines, PositionKey<T>(), options), measureEngine(bench, ctx, engines, WholeKey<T>(), options)), ...);
+  }, uniquifyEngines());
+
+  bench.printTimings();
+  if (options.perf)
+    bench.printCounters();
+  return bench.results();
+}
+
+
+// Example of overlapping the deduplication of frame N with the acquisition
+// of frame N + 1, using `async_stable_uniquify()` on two alternating buffers.
+void
+benchmarkAsyncDoubleBuffer(size_t n, size_t numFrames)
+{
   const auto posLess = [](const Point3D & a, const Point3D & b) { return get<0>(a) < get<0>(b); };
   const auto posEqual = [](const Point3D & a, const Point3D & b) { return get<0>(a) == get<0>(b); };
 
-  // stable_unique_iterators()
-  {
-    vector<Point3D> v = inputCloud; // copy
-    cout << "stable_unique_iterators..." << endl;
-    const auto t0 = chrono::steady_clock::now();
-    // Only compare point positions.
-    const size_t numUniques = iterator_sorting::stable_unique_iterators(v.begin(), v.end(), posLess, posEqual).size();
-    const auto t1 = chrono::steady_clock::now();
-    duration_stable_unique_iterators = chrono::duration<double>(t1 - t0).count();
-    cout << "stable_unique_iterators done, got " << numUniques << " uniques" << endl;
-  }
-
-  // stable_unique_iterators(), comparing whole `Point3D`
-  {
-    vector<Point3D> v = inputCloud; // copy
-    cout << "stable_unique_iterators_whole..." << endl;
-    const auto t0 = chrono::steady_clock::now();
-    // Only compare point positions.
-    const size_t numUniques = iterator_sorting::stable_unique_iterators(v.begin(), v.end()).size();
-    const auto t1 = chrono::steady_clock::now();
-    duration_stable_unique_iterators_whole = chrono::duration<double>(t1 - t0).count();
-    cout << "stable_unique_iterators_whole done, got " << numUniques << " uniques" << endl;
-  }
-
-  // unstable_unique_iterators()
-  {
-    vector<Point3D> v = inputCloud; // copy
-    cout << "unstable_unique_iterators..." << endl;
-    const auto t0 = chrono::steady_clock::now();
-    // Only compare point positions.
-    const size_t numUniques = iterator_sorting::unstable_unique_iterators(v.begin(), v.end(), posLess, posEqual).size();
-    const auto t1 = chrono::steady_clock::now();
-    duration_unstable_unique_iterators = chrono::duration<double>(t1 - t0).count();
-    cout << "unstable_unique_iterators done, got " << numUniques << " uniques" << endl;
-  }
-
-  // direct element stable sorting (no indices)
-  {
-    vector<Point3D> v = inputCloud; // copy
-    cout << "direct_vector_stable_sort..." << endl;
-    const auto t0 = chrono::steady_clock::now();
-    std::stable_sort(v.begin(), v.end(), posLess);
-    v.erase(unique(v.begin(), v.end(), posEqual), v.end());
-    const size_t numUniques = v.size();
-    const auto t1 = chrono::steady_clock::now();
-    duration_direct_vector_stable_sort = chrono::duration<double>(t1 - t0).count();
-    cout << "direct_vector_stable_sort done, got " << numUniques << " uniques" << endl;
-  }
-
-  // direct element stable sorting (no indices), whole points
-  {
-    vector<Point3D> v = inputCloud; // copy
-    cout << "direct_vector_stable_sort_whole..." << endl;
-    const auto t0 = chrono::steady_clock::now();
-    std::stable_sort(v.begin(), v.end());
-    v.erase(unique(v.begin(), v.end()), v.end());
-    const size_t numUniques = v.size();
-    const auto t1 = chrono::steady_clock::now();
-    duration_direct_vector_stable_sort_whole = chrono::duration<double>(t1 - t0).count();
-    cout << "direct_vector_stable_sort_whole done, got " << numUniques << " uniques" << endl;
-  }
-
-  // direct element unstable sorting (no indices)
-  {
-    vector<Point3D> v = inputCloud; // copy
-    cout << "direct_vector_unstable_sort..." << endl;
-    const auto t0 = chrono::steady_clock::now();
-    std::sort(v.begin(), v.end(), posLess);
-    v.erase(unique(v.begin(), v.end(), posEqual), v.end());
-    const size_t numUniques = v.size();
-    const auto t1 = chrono::steady_clock::now();
-    duration_direct_vector_unstable_sort = chrono::duration<double>(t1 - t0).count();
-    cout << "direct_vector_unstable_sort done, got " << numUniques << " uniques" << endl;
-  }
-
-  // direct element unstable sorting (no indices), whole points
-  {
-    vector<Point3D> v = inputCloud; // copy
-    cout << "direct_vector_unstable_sort_whole..." << endl;
-    const auto t0 = chrono::steady_clock::now();
-    std::sort(v.begin(), v.end());
-    v.erase(unique(v.begin(), v.end()), v.end());
-    const size_t numUniques = v.size();
-    const auto t1 = chrono::steady_clock::now();
-    duration_direct_vector_unstable_sort_whole = chrono::duration<double>(t1 - t0).count();
-    cout << "direct_vector_unstable_sort_whole done, got " << numUniques << " uniques" << endl;
-  }
-
-  // std::unordered_set
-  {
-    vector<Point3D> v = inputCloud; // copy
-    cout << "std::unordered_set-uniqueing vector..." << endl;
-    const auto t0 = chrono::steady_clock::now();
-
-    unordered_set<Position, hash_tuple::hash<Position>> seenPositions;
-    seenPositions.reserve(v.size());
-    v.erase(std::remove_if(v.begin(), v.end(),
-      [&seenPositions](const Point3D & point)
-      {
-        const auto & pos = get<0>(point); // Only compare point positions.
-        return !seenPositions.insert(pos).second; // insert().second is false if the value couldn't be inserted (is a duplicate)
-      }),
-      v.end()
-    );
-    const size_t numUniques = seenPositions.size();
-    const auto t1 = chrono::steady_clock::now();
-    duration_unordered_set = chrono::duration<double>(t1 - t0).count();
-    cout << "std::unordered_set-uniqueing done, got " << numUniques << " uniques" << endl;
+  // Stand-in for acquiring a frame from a sensor.
+  const auto acquire = [n](vector<Point3D> & frame, size_t frameNumber) {
+    frame.resize(n);
+    std::generate(frame.begin(), frame.end(), [x = (double) frameNumber] () mutable -> Point3D { x += 0.00000001; return {{x, 0, 0}, {}}; });
+  };
+
+  cout << "Double-buffered frame loop, " << numFrames << " frames of n = " << ((double) n)
+       << ", scheduler concurrency " << iterator_sorting::default_scheduler().concurrency() << " ..." << endl;
+
+  size_t numUniquesSequential = 0;
+  const auto t0 = chrono::steady_clock::now();
+  {
+    vector<Point3D> frame;
+    for (size_t f = 0; f < numFrames; ++f) {
+      acquire(frame, f);
+      frame.erase(iterator_sorting::stable_uniquify(frame.begin(), frame.end(), posLess, posEqual), frame.end());
+      numUniquesSequential += frame.size();
+    }
   }
+  const auto t1 = chrono::steady_clock::now();
+
+  size_t numUniquesOverlapped = 0;
+  {
+    array<vector<Point3D>, 2> buffers;
+    acquire(buffers[0], 0);
+    for (size_t f = 0; f < numFrames; ++f) {
+      vector<Point3D> & current = buffers[f % 2];
+      // `current` must not be touched until the future is ready.
+      auto uniqueEnd = iterator_sorting::async_stable_uniquify(current.begin(), current.end(), posLess, posEqual);
+      if (f + 1 < numFrames)
+        acquire(buffers[(f + 1) % 2], f + 1);
+      current.erase(uniqueEnd.get(), current.end());
+      numUniquesOverlapped += current.size();
+    }
+  }
+  const auto t2 = chrono::steady_clock::now();
 
-#ifdef HAVE_DEPENDENCY_PHMAP
-  // phmap::flat_hash_set
-  {
-    vector<Point3D> v = inputCloud; // copy
-    cout << "phmap::flat_hash_set-uniqueing vector..." << endl;
-    const auto t0 = chrono::steady_clock::now();
-
-    phmap::flat_hash_set<Position> seenPositions;
-    seenPositions.reserve(v.size());
-    v.erase(std::remove_if(v.begin(), v.end(),
-      [&seenPositions](const Point3D & point)
-      {
-        const auto & pos = get<0>(point); // Only compare point positions.
-        return !seenPositions.insert(pos).second; // insert().second is false if the value couldn't be inserted (is a duplicate)
-      }),
-      v.end()
-    );
-    const size_t numUniques = seenPositions.size();
-    const auto t1 = chrono::steady_clock::now();
-    duration_flat_hash_set = chrono::duration<double>(t1 - t0).count();
-    cout << "phmap::flat_hash_set-uniqueing done, got " << numUniques << " uniques" << endl;
-  }
-#endif
-
-  const double ref = duration_stable_unique_iterators; // reference time against which we compute factors
-  cout << "Timing:" << endl;
   cout << fixed << setprecision(2);
-  cout << "  stable_unique_iterators:                         " << setw(7) << duration_stable_unique_iterators << " s" << endl;
-  cout << "  stable_unique_iterators_whole:                   " << setw(7) << duration_stable_unique_iterators_whole << " s (" << (duration_stable_unique_iterators_whole / ref) << " x)" << endl;
-  cout << "  unstable_unique_iterators:                       " << setw(7) << duration_unstable_unique_iterators << " s (" << (duration_unstable_unique_iterators / ref) << " x)" << endl;
-  cout << "  direct_vector_stable_sort:                       " << setw(7) << duration_direct_vector_stable_sort << " s (" << (duration_direct_vector_stable_sort / ref) << " x)" << endl;
-  cout << "  direct_vector_stable_sort_whole:                 " << setw(7) << duration_direct_vector_stable_sort_whole << " s (" << (duration_direct_vector_stable_sort_whole / ref) << " x)" << endl;
-  cout << "  direct_vector_unstable_sort:                     " << setw(7) << duration_direct_vector_unstable_sort << " s (" << (duration_direct_vector_unstable_sort / ref) << " x)" << endl;
-  cout << "  direct_vector_unstable_sort_whole:               " << setw(7) << duration_direct_vector_unstable_sort_whole << " s (" << (duration_direct_vector_unstable_sort_whole / ref) << " x)" << endl;
-  cout << "  unordered_set:                                   " << setw(7) << duration_unordered_set << " s (" << (duration_unordered_set / ref) << " x)" << endl;
-#ifdef HAVE_DEPENDENCY_PHMAP
-  cout << "  flat_hash_set:                                   " << setw(7) << duration_flat_hash_set << " s (" << (duration_flat_hash_set / ref) << " x)" << endl;
+  cout << "  sequential:                                      " << setw(7) << chrono::duration<double>(t1 - t0).count() << " s, " << numUniquesSequential << " uniques" << endl;
+  cout << "  overlapped (async_stable_uniquify):              " << setw(7) << chrono::duration<double>(t2 - t1).count() << " s, " << numUniquesOverlapped << " uniques" << endl;
+  cout << defaultfloat;
+}
+
+
+// One row of the index-based vs. direct sorting comparison.
+struct CrossoverRow
+{
+  string elementType;
+  size_t n;
+  double stableRatio;   // median direct_vector_stable_sort / stable_unique_iterators; NAN if not run
+  double unstableRatio; // median direct_vector_unstable_sort / unstable_unique_iterators; NAN if not run
+};
+
+
+template <typename Result>
+double
+medianRatio(const vector<Result> & results, const string & numerator, const string & denominator)
+{
+  const auto find = [&results](const string & name) -> const Result * {
+    for (const Result & r : results)
+      if (r.name == name) return &r;
+    return nullptr;
+  };
+  const Result * a = find(numerator);
+  const Result * b = find(denominator);
+  return a && b ? a->stats.median / b->stats.median : NAN;
+}
+
+
+// Prints, per element type and size, how much slower sorting the elements directly is
+// than sorting their indices (> 1: index-based is faster).
+void
+printCrossover(const vector<CrossoverRow> & rows)
+{
+  cout << "Crossover (direct sort time / index sort time, > 1: index-based faster):" << endl;
+  cout << "  " << left << setw(28) << "element type" << right << setw(12) << "n" << setw(10) << "stable" << setw(10) << "unstable" << endl;
+  cout << fixed << setprecision(2);
+  for (const CrossoverRow & row : rows) {
+    cout << "  " << left << setw(28) << row.elementType << right << setw(12) << row.n
+         << setw(10) << row.stableRatio << setw(10) << row.unstableRatio << endl;
+  }
+  cout << defaultfloat << endl;
+}
+
+
+// Revision of the benchmarked code; `make bench` passes `git describe`.
+#ifndef BENCH_REVISION
+#define BENCH_REVISION "unknown"
+#endif
+
+// Description of the machine and build, recorded with the results
+// so that they can be compared across machines and commits.
+vector<pair<string, string>>
+machineInfo(const BenchOptions & options)
+{
+  const time_t now = time(nullptr);
+  char timestamp[32];
+  strftime(timestamp, sizeof timestamp, "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  const string memKb = procField("/proc/meminfo", "MemTotal");
+#if defined(__clang__)
+  const string compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+  const string compiler = "gcc " __VERSION__;
+#else
+  const string compiler = "unknown";
 #endif
+  return {
+    {"timestamp", timestamp},
+    {"revision", BENCH_REVISION},
+    {"command", options.commandLine},
+    {"cpu", procField("/proc/cpuinfo", "model name")},
+    {"hardware_threads", to_string(std::thread::hardware_concurrency())},
+    {"memory_bytes", memKb.empty() ? "" : to_string(stoull(memKb) * 1024)},
+    {"simd_level", iterator_sorting::simd_level_name(iterator_sorting::active_simd_level())},
+    {"compiler", compiler},
+  };
 }
 
+// One measured algorithm on one input, as written by `ResultWriter`.
+struct ResultRecord
+{
+  string dataset;        // `DatasetSpec::describe()`
+  string elementType;
+  size_t elementBytes;
+  size_t n;
+  size_t threads;        // concurrency of the library scheduler
+  string algorithm;
+  string label;          // algorithm with its note, as printed
+  TimingStats stats;
+  TimingStats coldStats; // with `--cold`; `reps` 0: not measured
+  size_t numUniques;
+  double peakHeapBytes;  // extra heap bytes allocated by the algorithm; NAN: unknown
+  double peakRssBytes;   // growth of the peak resident set size; NAN: unknown
+  PerfValues perf;       // mean `--perf` counts per run; NAN: not measured
+};
+
+// Writes results as they come in to the `--json` and `--csv` files, for
+// `report.py` and for comparing runs. The JSON file is an object with the
+// `machineInfo()` under "machine" and one object per record under "results";
+// the CSV file has one row per record, with the machine columns repeated,
+// so that files from several runs can simply be concatenated.
+class ResultWriter
+{
+public:
+  explicit ResultWriter(const BenchOptions & options)
+    : machine_(machineInfo(options))
+  {
+    if (!options.jsonPath.empty()) open(json_, options.jsonPath);
+    if (!options.csvPath.empty()) open(csv_, options.csvPath);
+
+    if (json_.is_open()) {
+      json_ << "{\n  \"machine\": {";
+      for (size_t i = 0; i < machine_.size(); ++i)
+        json_ << (i ? "," : "") << "\n    " << jsonString(machine_[i].first) << ": " << jsonString(machine_[i].second);
+      json_ << "\n  },\n  \"results\": [";
+    }
+    if (csv_.is_open()) {
+      for (const auto & field : machine_)
+        csv_ << field.first << ",";
+      csv_ << "dataset,element_type,element_bytes,n,threads,algorithm,label,reps,min_s,median_s,p90_s,mean_s,stddev_s,cold_reps,cold_min_s,cold_median_s,cold_p90_s,uniques,peak_heap_bytes,peak_rss_bytes";
+      for (const PerfEvent & event : perfEvents)
+        csv_ << "," << event.name;
+      csv_ << "\n";
+    }
+  }
+
+  ~ResultWriter()
+  {
+    if (json_.is_open())
+      json_ << "\n  ]\n}\n";
+  }
+
+  ResultWriter(const ResultWriter &) = delete;
+  ResultWriter & operator=(const ResultWriter &) = delete;
+
+  void
+  write(const ResultRecord & r)
+  {
+    const TimingStats & st = r.stats;
+    if (json_.is_open()) {
+      json_ << (numWritten_ ? "," : "") << "\n    {"
+            << "\"dataset\": " << jsonString(r.dataset)
+            << ", \"element_type\": " << jsonString(r.elementType)
+            << ", \"element_bytes\": " << r.elementBytes
+            << ", \"n\": " << r.n
+            << ", \"threads\": " << r.threads
+            << ", \"algorithm\": " << jsonString(r.algorithm)
+            << ", \"label\": " << jsonString(r.label)
+            << ", \"reps\": " << st.reps
+            << ", \"min_s\": " << number(st.min)
+            << ", \"median_s\": " << number(st.median)
+            << ", \"p90_s\": " << number(st.p90)
+            << ", \"mean_s\": " << number(st.mean)
+            << ", \"stddev_s\": " << number(st.stddev)
+            << ", \"cold_reps\": " << r.coldStats.reps
+            << ", \"cold_min_s\": " << coldNumber(r.coldStats, r.coldStats.min)
+            << ", \"cold_median_s\": " << coldNumber(r.coldStats, r.coldStats.median)
+            << ", \"cold_p90_s\": " << coldNumber(r.coldStats, r.coldStats.p90)
+            << ", \"uniques\": " << r.numUniques
+            << ", \"peak_heap_bytes\": " << number(r.peakHeapBytes)
+            << ", \"peak_rss_bytes\": " << number(r.peakRssBytes);
+      for (size_t e = 0; e < perfEvents.size(); ++e)
+        json_ << ", \"" << perfEvents[e].name << "\": " << number(r.perf[e]);
+      json_ << "}";
+      json_.flush(); // keep partial results of long runs
+    }
+    if (csv_.is_open()) {
+      for (const auto & field : machine_)
+        csv_ << csvField(field.second) << ",";
+      csv_ << csvField(r.dataset) << "," << csvField(r.elementType) << "," << r.elementBytes << "," << r.n << "," << r.threads
+           << "," << csvField(r.algorithm) << "," << csvField(r.label) << "," << st.reps
+           << "," << number(st.min) << "," << number(st.median) << "," << number(st.p90) << "," << number(st.mean) << "," << number(st.stddev)
+           << "," << r.coldStats.reps << "," << coldNumber(r.coldStats, r.coldStats.min) << "," << coldNumber(r.coldStats, r.coldStats.median)
+           << "," << coldNumber(r.coldStats, r.coldStats.p90)
+           << "," << r.numUniques << "," << number(r.peakHeapBytes) << "," << number(r.peakRssBytes);
+      for (const double count : r.perf)
+        csv_ << "," << number(count);
+      csv_ << "\n";
+      csv_.flush();
+    }
+    ++numWritten_;
+  }
+
+private:
+  static void
+  open(ofstream & out, const string & path)
+  {
+    out.open(path);
+    if (!out) throw runtime_error("cannot write " + path);
+  }
+
+  static string
+  jsonString(const string & s)
+  {
+    string quoted = "\"";
+    for (const char c : s) {
+      if (c == '"' || c == '\\') {
+        quoted += '\\';
+        quoted += c;
+      } else if ((unsigned char) c < 0x20) {
+        char escaped[8];
+        snprintf(escaped, sizeof escaped, "\\u%04x", (unsigned) c);
+        quoted += escaped;
+      } else {
+        quoted += c;
+      }
+    }
+    return quoted + "\"";
+  }
+
+  static string
+  csvField(const string & s)
+  {
+    if (s.find_first_of(",\"\n") == string::npos) return s;
+    string quoted = "\"";
+    for (const char c : s) {
+      if (c == '"') quoted += '"';
+      quoted += c;
+    }
+    return quoted + "\"";
+  }
+
+  // 9 significant digits (well below timer resolution), `null` for non-finite values.
+  static string
+  number(const double x)
+  {
+    if (!isfinite(x)) return "null";
+    ostringstream out;
+    out << setprecision(9) << x;
+    return out.str();
+  }
+
+  static string coldNumber(const TimingStats & cold, double x) { return cold.reps == 0 ? "null" : number(x); }
+
+  vector<pair<string, string>> machine_;
+  ofstream json_;
+  ofstream csv_;
+  size_t numWritten_ = 0;
+};
 
-void run_benchmark()
+
+// Runs all datasets, sizes and element types. Returns the number of `--verify` mismatches.
+size_t
+run_benchmark(const BenchOptions & options, ResultWriter & writer)
 {
-  for (double size = 1000; size <= 100 * 1000000; size *= sqrtl(10.0))
+  vector<string> mismatches;
+  size_t numVerified = 0;
+  for (const DatasetSpec & dataset : options.datasets)
   {
-    benchmarkUniquify( (size_t) round(size) );
-    cout << endl;
+    cout << "Dataset " << dataset.describe() << endl << endl;
+    vector<CrossoverRow> crossover;
+    for (const size_t n : options.sizes)
+    {
+      cout << "Initing vector, n = " << ((double) n) << " ..." << endl;
+      const vector<Point3D> inputCloud = generateDataset(dataset, n);
+      if (options.hashDiagnostics)
+        printHashDiagnostics(inputCloud);
+      for (const size_t payload : options.payloads) {
+        withElementType(payload, [&](auto type) {
+          using T = typename decltype(type)::type;
+          cout << "Element type " << elementTypeName<T>() << endl;
+          const auto results = benchmarkUniquify(convertCloud<T>(inputCloud), options);
+          for (const auto & r : results) {
+            ++numVerified;
+            if (!r.mismatch.empty())
+              mismatches.push_back(dataset.describe() + ", n = " + to_string(n) + ", " + elementTypeName<T>() + ": " + r.name + ": " + r.mismatch);
+            writer.write({
+              dataset.describe(), elementTypeName<T>(), sizeof(T), n, iterator_sorting::default_scheduler().concurrency(),
+              r.name, r.label, r.stats, r.coldStats, r.numUniques, r.peakHeapBytes, r.peakRssBytes, r.perf,
+            });
+          }
+          crossover.push_back({
+            elementTypeName<T>(),
+            n,
+            medianRatio(results, "direct_vector_stable_sort", "stable_unique_iterators"),
+            medianRatio(results, "direct_vector_unstable_sort", "unstable_unique_iterators"),
+          });
+        });
+        cout << endl;
+      }
+    }
+    if (options.payloads.size() > 1)
+      printCrossover(crossover);
+  }
+
+  if (options.verify) {
+    numVerified += verifyHashes(mismatches);
+    if (mismatches.empty()) {
+      cout << "Verification: all " << numVerified << " outputs match the reference" << endl;
+    } else {
+      cout << "Verification: " << mismatches.size() << " of " << numVerified << " outputs do NOT match the reference:" << endl;
+      for (const string & mismatch : mismatches)
+        cout << "  " << mismatch << endl;
+    }
   }
+  return mismatches.size();
+}
+
+
+// Geometric sequence of sizes from `from` to `to` (inclusive, up to rounding), with ratio `factor`.
+vector<size_t>
+sizeRange(double from, double to, double factor)
+{
+  vector<size_t> sizes;
+  for (double size = from; size <= to * 1.000001; size *= factor)
+    sizes.push_back((size_t) round(size));
+  return sizes;
+}
+
+
+void
+printUsage(ostream & out, const char * argv0)
+{
+  out << "Usage: " << argv0 << " [options]\n"
+      << "  --sizes N[,N...]           input sizes (e.g. 1000,1e6)\n"
+      << "  --range FROM:TO[:FACTOR]   sizes FROM, FROM*FACTOR, ... up to TO (default factor sqrt(10))\n"
+      << "                             default: --range 1000:1e8\n"
+      << "  --algos NAME[,NAME...]     only run these algorithms; NAME* matches by prefix\n"
+      << "  --reps N                   timed runs per algorithm and size, after one warm-up run\n"
+      << "                             (default: as many as fit into the budget)\n"
+      << "  --budget SECONDS           time budget for the timed runs per algorithm and size (default 1)\n"
+      << "  --max-reps N               at most this many runs from the budget (default 1000)\n"
+      << "  --threads N                threads for the parallel algorithms (default: all hardware threads)\n"
+      << "  --dataset PRESET[:K=V,...] input distribution; may be given several times (default: increasing)\n"
+      << "                             presets:";
+  for (const auto & preset : datasetPresets)
+    out << " " << preset.first;
+  out << "\n"
+      << "                             parameters: dup=FRACTION card=DISTINCT zipf=EXPONENT\n"
+      << "                             order=generated|shuffled|sorted|reversed positions=uniform|clustered|increasing\n"
+      << "                             run=LENGTH seed=N\n"
+      << "  --payload B[,B...]         element types: points with B bytes of payload next to the position\n"
+      << "                             (0: Point3D, the default; or 32, 64, 128, 256, 1024, or 'all'; these need -DBENCH_FULL);\n"
+      << "                             with several, a crossover table of index-based vs. direct sorting follows\n"
+      << "  --json FILE                also write all results, with machine info, as JSON to FILE\n"
+      << "  --csv FILE                 also write all results, with machine info, as CSV to FILE\n"
+      << "                             (for report.py, which rebuilds the speedup tables and graph)\n"
+      << "  --verify                   check every algorithm's output (which elements survive, and their order)\n"
+      << "                             against a reference; exits with status 2 on a mismatch.\n"
+      << "                             Defaults to all dataset presets, sizes around the small-n and SIMD\n"
+      << "                             thresholds, and --reps 1; engines using the SIMD kernels are\n"
+      << "                             checked at every SIMD level the CPU supports (as NAME@LEVEL)\n"
+      << "  --cold llc|input           also time every algorithm with cold caches, side by side with the warm timings:\n"
+      << "                             llc: write a buffer of twice the last-level cache size before each run;\n"
+      << "                             input: flush the input's cache lines (as if freshly arrived by DMA or from disk)\n"
+      << "  --perf                     also count cycles, instructions, cache, dTLB and branch misses and page faults\n"
+      << "                             over the timed runs (Linux perf_event_open; missing counters print as -)\n"
+      << "  --simd LEVEL               use the SIMD kernels of LEVEL (scalar, sse2, avx2, avx512f)\n"
+      << "                             instead of the best one the CPU supports\n"
+      << "  --hash-diagnostics         print hash distribution statistics per size\n"
+      << "  --async-example            run the double-buffering example instead\n"
+      << "  --help, -h                 print this help and exit\n";
 }
 
 
 int main(int argc, char const *argv[])
 {
-  run_benchmark();
+  BenchOptions options;
+  for (int i = 0; i < argc; ++i)
+    options.commandLine += (i ? " " : "") + string(argv[i]);
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const string arg = argv[i];
+      const auto value = [&]() -> string {
+        if (i + 1 >= argc) throw invalid_argument(arg + " needs a value");
+        return argv[++i];
+      };
+      if (arg == "--help" || arg == "-h") {
+        printUsage(cout, argv[0]);
+        return 0;
+      } else if (arg == "--hash-diagnostics") {
+        options.hashDiagnostics = true;
+      } else if (arg == "--async-example") {
+        options.asyncExample = true;
+      } else if (arg == "--sizes") {
+        for (const string & size : splitList(value()))
+          options.sizes.push_back((size_t) round(stod(size)));
+      } else if (arg == "--range") {
+        const vector<string> parts = splitList(value(), ':');
+        if (parts.size() < 2 || parts.size() > 3) throw invalid_argument("--range needs FROM:TO[:FACTOR]");
+        const double factor = parts.size() == 3 ? stod(parts[2]) : sqrtl(10.0);
+        if (factor <= 1) throw invalid_argument("--range FACTOR must be > 1");
+        for (const size_t size : sizeRange(stod(parts[0]), stod(parts[1]), factor))
+          options.sizes.push_back(size);
+      } else if (arg == "--algos") {
+        options.algos = splitList(value());
+      } else if (arg == "--reps") {
+        options.reps = std::max<size_t>(1, stoul(value()));
+      } else if (arg == "--budget") {
+        options.budget = stod(value());
+      } else if (arg == "--max-reps") {
+        options.maxReps = std::max<size_t>(1, stoul(value()));
+      } else if (arg == "--threads") {
+        options.threads = stoul(value());
+      } else if (arg == "--payload") {
+        const string list = value();
+        options.payloads.clear();
+        for (const string & payload : list == "all" ? vector<string>() : splitList(list)) {
+          options.payloads.push_back(stoul(payload));
+          if (std::find(payloadSizes.begin(), payloadSizes.end(), options.payloads.back()) == payloadSizes.end())
+            throw invalid_argument("unsupported payload size " + payload + (benchFull ? "" : " (build with -DBENCH_FULL for payloads)"));
+        }
+        if (list == "all")
+          options.payloads = payloadSizes;
+      } else if (arg == "--verify") {
+        options.verify = true;
+      } else if (arg == "--cold") {
+        const string mode = value();
+        if (mode == "llc") options.cold = ColdMode::llc;
+        else if (mode == "input") options.cold = ColdMode::input;
+        else throw invalid_argument("--cold needs llc or input");
+      } else if (arg == "--perf") {
+        options.perf = true;
+      } else if (arg == "--simd") {
+        options.simdLevel = value();
+        if (std::none_of(simdLevels.begin(), simdLevels.end(), [&](auto level) { return options.simdLevel == iterator_sorting::simd_level_name(level); }))
+          throw invalid_argument("--simd needs scalar, sse2, avx2 or avx512f");
+      } else if (arg == "--json") {
+        options.jsonPath = value();
+      } else if (arg == "--csv") {
+        options.csvPath = value();
+      } else if (arg == "--dataset") {
+        options.datasets.push_back(parseDatasetSpec(value()));
+      } else {
+        throw invalid_argument("unknown option " + arg);
+      }
+    }
+  } catch (const std::exception & e) {
+    cerr << e.what() << endl;
+    printUsage(cerr, argv[0]);
+    return 1;
+  }
+  if (options.verify) {
+    // Edge cases of the small-n paths, the SIMD block and vector widths, and one larger size.
+    if (options.sizes.empty())
+      options.sizes = { 0, 1, 2, 3, 7, 8, 9, 15, 16, 17, 100, 1023, 1024, 1025, 16383, 16384, 16385, 100000 };
+    if (options.datasets.empty()) {
+      for (const auto & preset : datasetPresets)
+        options.datasets.push_back(preset.second);
+    }
+    if (options.reps == 0)
+      options.reps = 1;
+  }
+  if (options.sizes.empty())
+    options.sizes = sizeRange(1000, 100 * 1000000, sqrtl(10.0));
+  if (options.datasets.empty())
+    options.datasets.push_back(parseDatasetSpec("increasing"));
+
+  if (options.perf) {
+    // Before the scheduler's workers start, so that they inherit the counters.
+    const PerfCounters & counters = perfCounters();
+    if (!counters.anyAvailable())
+      cout << "Performance counters unavailable (" << counters.error() << "), continuing without" << endl;
+    else if (!counters.error().empty())
+      cout << "Some performance counters unavailable: " << counters.missing() << " (" << counters.error() << ")" << endl;
+  }
+
+  if (options.threads != 0) {
+    iterator_sorting::scheduler_options schedulerOptions;
+    schedulerOptions.numWorkers = options.threads - 1; // the calling thread participates
+    iterator_sorting::configure_default_scheduler(schedulerOptions);
+  }
+
+  for (const iterator_sorting::simd_level level : simdLevels) {
+    if (options.simdLevel == iterator_sorting::simd_level_name(level) && iterator_sorting::set_simd_level(level) != level)
+      cout << "SIMD level " << options.simdLevel << " not supported by this CPU" << endl;
+  }
+  cout << "SIMD level: " << iterator_sorting::simd_level_name(iterator_sorting::active_simd_level()) << endl;
+  if (options.asyncExample) {
+    benchmarkAsyncDoubleBuffer(1000000, 10);
+    return 0;
+  }
+  try {
+    ResultWriter writer(options);
+    if (run_benchmark(options, writer) != 0)
+      return 2;
+  } catch (const std::exception & e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
   return 0;
 }
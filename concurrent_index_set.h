@@ -0,0 +1,126 @@
+#ifndef CONCURRENT_INDEX_SET_H
+#define CONCURRENT_INDEX_SET_H
+
+// An insert-only, lock-free hash set of element indices,
+// for deduplicating from many threads at once into one shared set.
+//
+// The set does not store keys; it stores indices of elements,
+// and looks their keys up through a caller-provided `keyAt(index)`.
+// Each slot is a single 64-bit atomic holding `index + 1` (0 = empty)
+// in its low bits and a tag of high hash bits in its high bits,
+// so that most non-matching slots are rejected without touching the key.
+//
+// Insertion claims an empty slot with a compare-and-swap.
+// When an equal key is already present, the slot is lowered to the smaller of
+// the two indices (again by CAS), so after all insertions each key's slot
+// holds the smallest index it was inserted with, regardless of thread timing.
+// This makes first-occurrence deduplication deterministic.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+namespace iterator_sorting {
+
+template <
+  typename KeyAt,
+  typename Hash,
+  typename KeyEqual = std::equal_to<>
+>
+class concurrent_index_set
+{
+public:
+  // Indices must be smaller than `2^indexBits - 1`.
+  static constexpr unsigned indexBits = 40;
+
+  // Creates a set that can hold up to `maxElements` distinct keys,
+  // at a load factor of at most 1/2.
+  concurrent_index_set(
+    const size_t maxElements,
+    KeyAt keyAt,
+    Hash hash = Hash{},
+    KeyEqual keyEqual = KeyEqual{}
+  )
+    : keyAt_(std::move(keyAt))
+    , hash_(std::move(hash))
+    , keyEqual_(std::move(keyEqual))
+  {
+    if (maxElements >= (uint64_t{1} << indexBits) - 1)
+      throw std::length_error("concurrent_index_set: too many elements");
+    capacity_ = 2;
+    while (capacity_ < 2 * maxElements)
+      capacity_ *= 2;
+    mask_ = capacity_ - 1;
+    slots_ = std::make_unique<std::atomic<uint64_t>[]>(capacity_); // value-initialised to 0 (empty)
+  }
+
+  // Inserts the element `index`. Thread-safe.
+  // Returns true if its key was not present yet ("first inserter wins").
+  // Either way, the key's slot ends up holding the smallest index inserted for it.
+  // At most `maxElements` distinct keys may be inserted; beyond that, once the
+  // table is full, throws `std::length_error` instead of probing forever.
+  // `index` must be smaller than `2^indexBits - 1`, or `std::length_error` is thrown.
+  bool
+  insert(const size_t index)
+  {
+    if (index >= (uint64_t{1} << indexBits) - 1)
+      throw std::length_error("concurrent_index_set: index too large");
+    const auto & key = keyAt_(index);
+    const uint64_t h = static_cast<uint64_t>(hash_(key));
+    const uint64_t entry = (tagOf(h) << indexBits) | (index + 1);
+
+    for (size_t s = h & mask_, probes = 0; ; s = (s + 1) & mask_) {
+      if (probes++ == capacity_)
+        throw std::length_error("concurrent_index_set: full, more than maxElements distinct keys inserted");
+      uint64_t cur = slots_[s].load(std::memory_order_acquire);
+      if (cur == 0) {
+        if (slots_[s].compare_exchange_strong(cur, entry, std::memory_order_acq_rel))
+          return true;
+        // Lost the race for this slot; `cur` now holds the winner, examine it below.
+      }
+      if ((cur >> indexBits) == tagOf(h) && keyEqual_(keyAt_(indexOf(cur)), key)) {
+        // Same key. Slots never change their key once set, only their index,
+        // so lowering the index to ours is safe against concurrent lowering.
+        while (indexOf(cur) > index) {
+          if (slots_[s].compare_exchange_weak(cur, entry, std::memory_order_acq_rel))
+            break;
+        }
+        return false;
+      }
+    }
+  }
+
+  // Calls `f(index)` for the smallest index of each distinct key,
+  // in the slot range `[slotBegin, slotEnd)` (in unspecified index order).
+  // No insertion may be in progress.
+  template <typename F>
+  void
+  for_each_min_index(const size_t slotBegin, const size_t slotEnd, F f) const
+  {
+    for (size_t s = slotBegin; s < slotEnd; ++s) {
+      const uint64_t cur = slots_[s].load(std::memory_order_relaxed);
+      if (cur != 0)
+        f(indexOf(cur));
+    }
+  }
+
+  size_t capacity() const { return capacity_; }
+
+private:
+  static uint64_t tagOf(const uint64_t h) { return h >> indexBits; }
+  static size_t indexOf(const uint64_t entry) { return static_cast<size_t>((entry & ((uint64_t{1} << indexBits) - 1)) - 1); }
+
+  KeyAt keyAt_;
+  Hash hash_;
+  KeyEqual keyEqual_;
+  size_t capacity_;
+  size_t mask_;
+  std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+};
+
+} // namespace iterator_sorting
+
+#endif // CONCURRENT_INDEX_SET_H
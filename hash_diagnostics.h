@@ -0,0 +1,160 @@
+#ifndef HASH_DIAGNOSTICS_H
+#define HASH_DIAGNOSTICS_H
+
+// Measures how well a hash function distributes a given input,
+// so that slowdowns of hash-based deduplication can be attributed
+// to the hash (instead of e.g. the number of duplicates).
+//
+// `analyse_hash()` inserts the keys `proj(value)` of a range into
+// a simulated open-addressing (linear probing) table and reports:
+//
+// * Bucket occupancy histogram, using the low bits of the hash as bucket
+//   (as power-of-two sized tables do).
+// * Mean and max probe length of the simulated table.
+// * The low-bits collision rate: the fraction of distinct keys whose bucket
+//   was already occupied by another key. For a uniformly random hash with
+//   `m` buckets and `k` keys, the expected rate is `1 - m/k * (1 - exp(-k/m))`.
+// * Full 64-bit hash collisions between distinct keys.
+//
+// Works with any hash functor, e.g. `hash_tuple::hash` and `hash_tuple::legacy::hash`.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <ostream>
+#include <vector>
+
+namespace hash_diagnostics {
+
+struct hash_report
+{
+  size_t numKeys = 0;               // elements in the input
+  size_t numDistinct = 0;           // distinct keys among them
+  size_t numBuckets = 0;            // power of two
+  std::vector<size_t> occupancy;    // occupancy[k]: buckets holding k distinct keys (last entry: k or more)
+  double lowBitsCollisionRate = 0;  // fraction of distinct keys landing in an already occupied bucket
+  double expectedCollisionRate = 0; // the same for a uniformly random hash
+  size_t fullHashCollisions = 0;    // distinct keys whose 64-bit hash equals that of another distinct key
+  double meanProbeLength = 0;       // slots inspected per insertion into the simulated table
+  size_t maxProbeLength = 0;
+};
+
+// Analyses the distribution of `hash(proj(value))` over `[begin, end)`,
+// for a linear probing table of the smallest power-of-two size
+// that keeps the load factor at most `maxLoadFactor`.
+//
+// Complexity:
+// Given `N` as `last - first`:
+// * O(N) applications of `hash`, plus the probing work being measured
+// * O(N / maxLoadFactor) additional memory
+template <
+  typename It,
+  typename Hash,
+  typename Proj = std::identity,
+  typename KeyEqual = std::equal_to<>
+>
+hash_report
+analyse_hash(
+  const It begin,
+  const It end,
+  Hash hash,
+  Proj proj = Proj{},
+  KeyEqual keyEqual = KeyEqual{},
+  const double maxLoadFactor = 0.5,
+  const size_t maxOccupancy = 8
+)
+{
+  hash_report r;
+  r.numKeys = static_cast<size_t>(std::distance(begin, end));
+  r.numBuckets = 1;
+  while (static_cast<double>(r.numBuckets) * maxLoadFactor < static_cast<double>(r.numKeys))
+    r.numBuckets *= 2;
+  const size_t mask = r.numBuckets - 1;
+
+  struct Slot
+  {
+    uint64_t hash;
+    It it;
+    bool used;
+  };
+  std::vector<Slot> table(r.numBuckets, Slot{0, begin, false});
+  std::vector<uint32_t> bucketCounts(r.numBuckets, 0);
+  std::vector<uint64_t> distinctHashes;
+  distinctHashes.reserve(r.numKeys);
+
+  size_t totalProbes = 0;
+  size_t occupiedHits = 0;
+  for (It it = begin; it != end; ++it) {
+    const auto & key = std::invoke(proj, *it);
+    const uint64_t h = static_cast<uint64_t>(hash(key));
+    size_t probes = 1;
+    bool duplicate = false;
+    for (size_t s = h & mask; ; s = (s + 1) & mask, ++probes) {
+      if (!table[s].used) {
+        table[s] = {h, it, true};
+        break;
+      }
+      if (table[s].hash == h && keyEqual(std::invoke(proj, *table[s].it), key)) {
+        duplicate = true;
+        break;
+      }
+    }
+    totalProbes += probes;
+    r.maxProbeLength = std::max(r.maxProbeLength, probes);
+    if (!duplicate) {
+      occupiedHits += bucketCounts[h & mask]++ != 0;
+      distinctHashes.push_back(h);
+    }
+  }
+
+  r.numDistinct = distinctHashes.size();
+  r.meanProbeLength = r.numKeys == 0 ? 0 : static_cast<double>(totalProbes) / static_cast<double>(r.numKeys);
+  r.lowBitsCollisionRate = r.numDistinct == 0 ? 0 : static_cast<double>(occupiedHits) / static_cast<double>(r.numDistinct);
+  if (r.numDistinct != 0) {
+    const double k = static_cast<double>(r.numDistinct);
+    const double m = static_cast<double>(r.numBuckets);
+    r.expectedCollisionRate = 1 - m / k * (1 - std::exp(-k / m));
+  }
+
+  r.occupancy.assign(maxOccupancy + 1, 0);
+  for (const uint32_t c : bucketCounts)
+    ++r.occupancy[std::min<size_t>(c, maxOccupancy)];
+
+  std::sort(distinctHashes.begin(), distinctHashes.end());
+  for (size_t i = 0; i < distinctHashes.size(); ) {
+    size_t j = i + 1;
+    while (j < distinctHashes.size() && distinctHashes[j] == distinctHashes[i])
+      ++j;
+    if (j - i >= 2)
+      r.fullHashCollisions += j - i; // every key of a group sharing one hash
+    i = j;
+  }
+
+  return r;
+}
+
+// Prints `r` in a human-readable form, each line prefixed with `indent`.
+inline void
+print_hash_report(std::ostream & os, const hash_report & r, const char * indent = "  ")
+{
+  const auto flags = os.flags();
+  const auto precision = os.precision();
+  os << std::fixed << std::setprecision(3);
+  os << indent << "keys: " << r.numKeys << ", distinct: " << r.numDistinct << ", buckets: " << r.numBuckets << "\n";
+  os << indent << "low-bits collision rate: " << r.lowBitsCollisionRate << " (random hash: " << r.expectedCollisionRate << ")"
+     << ", full 64-bit collisions: " << r.fullHashCollisions << "\n";
+  os << indent << "probe length: mean " << r.meanProbeLength << ", max " << r.maxProbeLength << "\n";
+  os << indent << "bucket occupancy:";
+  for (size_t k = 0; k < r.occupancy.size(); ++k)
+    os << " " << k << (k + 1 == r.occupancy.size() ? "+" : "") << ":" << r.occupancy[k];
+  os << "\n";
+  os.flags(flags);
+  os.precision(precision);
+}
+
+} // namespace hash_diagnostics
+
+#endif // HASH_DIAGNOSTICS_H
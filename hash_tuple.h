@@ -2,23 +2,173 @@
 #define HASH_TUPLE_H
 
 // Boilerplate to allow hashing tuples.
-// From: https://stackoverflow.com/questions/7110301/generic-hash-for-tuples-in-unordered-map-unordered-set/7115547#7115547
+//
+// Tuples whose members are all integral, `float` or `double` (possibly nested, such as `Point3D`)
+// are packed into a byte buffer and hashed in one pass with a 64-bit
+// wyhash-style function; this mixes all bits of all members, unlike combining
+// per-member `std::hash` values (which for integers is the identity).
+// Other tuples combine their members' hashes.
+//
+// The original Boost-style combiner is kept as `hash_tuple::legacy::hash`
+// for comparison in benchmarks.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+
 namespace hash_tuple {
 
+namespace detail {
+
+  // Constants from wyhash (public domain, Wang Yi).
+  inline constexpr uint64_t secret[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+  };
+
+  // 64 x 64 -> 128 bit multiplication; sets `a` to the low and `b` to the high half.
+  inline void mum(uint64_t & a, uint64_t & b)
+  {
+#if defined(__SIZEOF_INT128__)
+    const __uint128_t r = static_cast<__uint128_t>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+#else
+    const uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+    const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const uint64_t t = rl + (rm0 << 32);
+    const uint64_t lo = t + (rm1 << 32);
+    const uint64_t c = (t < rl) + (lo < t);
+    b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    a = lo;
+#endif
+  }
+
+  // Folds the 128-bit product of `a` and `b` into 64 bits.
+  inline uint64_t mix(uint64_t a, uint64_t b)
+  {
+    mum(a, b);
+    return a ^ b;
+  }
+
+  inline uint64_t read64(const unsigned char * p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+  inline uint64_t read32(const unsigned char * p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+} // namespace detail
+
+  // Hashes `len` bytes at `data` to 64 bits (wyhash-style).
+  inline uint64_t
+  hash_bytes(const void * data, size_t len, uint64_t seed = 0)
+  {
+    using namespace detail;
+    const unsigned char * p = static_cast<const unsigned char *>(data);
+    seed ^= mix(seed ^ secret[0], secret[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+      if (len >= 4) {
+        a = (read32(p) << 32) | read32(p + ((len >> 3) << 2));
+        b = (read32(p + len - 4) << 32) | read32(p + len - 4 - ((len >> 3) << 2));
+      } else if (len > 0) {
+        a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+        b = 0;
+      } else {
+        a = b = 0;
+      }
+    } else {
+      size_t i = len;
+      if (i > 48) {
+        uint64_t see1 = seed, see2 = seed;
+        do {
+          seed = mix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+          see1 = mix(read64(p + 16) ^ secret[2], read64(p + 24) ^ see1);
+          see2 = mix(read64(p + 32) ^ secret[3], read64(p + 40) ^ see2);
+          p += 48;
+          i -= 48;
+        } while (i > 48);
+        seed ^= see1 ^ see2;
+      }
+      while (i > 16) {
+        seed = mix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+        i -= 16;
+        p += 16;
+      }
+      a = read64(p + i - 16);
+      b = read64(p + i - 8);
+    }
+    a ^= secret[1];
+    b ^= seed;
+    mum(a, b);
+    return mix(a ^ secret[0] ^ len, b ^ secret[1]);
+  }
+
+namespace detail {
+
+  // Types that can be hashed as packed bytes: those whose bytes are determined
+  // by their value, i.e. integral types, `float` and `double` (with -0.0
+  // canonicalised in `pack()`), and tuples of packable types.
+  // Not `long double`, whose object representation contains padding bytes
+  // with indeterminate contents; it is hashed with `std::hash`.
+  template <typename T>
+  struct packable : std::bool_constant<std::is_integral_v<T> || std::is_same_v<T, float> || std::is_same_v<T, double>> {};
+
+  template <typename ... TT>
+  struct packable<std::tuple<TT...>> : std::bool_constant<(packable<TT>::value && ...)> {};
+
+  template <typename T>
+  struct packed_size : std::integral_constant<size_t, sizeof(T)> {};
+
+  template <typename ... TT>
+  struct packed_size<std::tuple<TT...>> : std::integral_constant<size_t, (packed_size<TT>::value + ... + 0)> {};
+
+  // Writes the members of `v` back-to-back (no padding) to `out`, advancing it.
+  template <typename T>
+  void pack(const T & v, unsigned char * & out)
+  {
+    if constexpr (std::is_floating_point_v<T>) {
+      const T canonical = v == 0 ? T(0) : v; // -0.0 == 0.0, so they must hash equally
+      std::memcpy(out, &canonical, sizeof(T));
+      out += sizeof(T);
+    } else if constexpr (std::is_integral_v<T>) {
+      std::memcpy(out, &v, sizeof(T));
+      out += sizeof(T);
+    } else {
+      std::apply([&out](const auto & ... members) { (pack(members, out), ...); }, v);
+    }
+  }
+
+  // `std::array`, as a plain array may not have size 0 (empty tuples).
+  template <typename T>
+  size_t hash_packed(const T & v)
+  {
+    std::array<unsigned char, packed_size<T>::value> buf;
+    unsigned char * out = buf.data();
+    pack(v, out);
+    return static_cast<size_t>(hash_bytes(buf.data(), buf.size()));
+  }
+
+} // namespace detail
+
   template <typename TT>
   struct hash
   {
       size_t
       operator()(TT const& tt) const
       {
-          return std::hash<TT>()(tt);
+          if constexpr (detail::packable<TT>::value) {
+            return detail::hash_packed(tt);
+          } else {
+            return std::hash<TT>()(tt);
+          }
       }
   };
 
   template <class T>
   inline void hash_combine(std::size_t& seed, T const& v)
   {
-      seed ^= hash_tuple::hash<T>()(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+      seed = static_cast<size_t>(detail::mix(seed ^ detail::secret[0], hash_tuple::hash<T>()(v) ^ detail::secret[1]));
   }
 
 
@@ -42,6 +192,61 @@ namespace hash_tuple {
     }
   };
 
+  template <typename ... TT>
+  struct hash<std::tuple<TT...>>
+  {
+      size_t
+      operator()(std::tuple<TT...> const& tt) const
+      {
+          if constexpr (detail::packable<std::tuple<TT...>>::value) {
+            return detail::hash_packed(tt);
+          } else {
+            size_t seed = 0;
+            HashValueImpl<std::tuple<TT...> >::apply(seed, tt);
+            return seed;
+          }
+      }
+  };
+
+// The original 32-bit Boost `hash_combine` over `std::hash`, for comparison.
+// From: https://stackoverflow.com/questions/7110301/generic-hash-for-tuples-in-unordered-map-unordered-set/7115547#7115547
+namespace legacy {
+
+  template <typename TT>
+  struct hash
+  {
+      size_t
+      operator()(TT const& tt) const
+      {
+          return std::hash<TT>()(tt);
+      }
+  };
+
+  template <class T>
+  inline void hash_combine(std::size_t& seed, T const& v)
+  {
+      seed ^= legacy::hash<T>()(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+  }
+
+  template <class Tuple, size_t Index = std::tuple_size<Tuple>::value - 1>
+  struct HashValueImpl
+  {
+    static void apply(size_t& seed, Tuple const& tuple)
+    {
+      HashValueImpl<Tuple, Index-1>::apply(seed, tuple);
+      hash_combine(seed, std::get<Index>(tuple));
+    }
+  };
+
+  template <class Tuple>
+  struct HashValueImpl<Tuple,0>
+  {
+    static void apply(size_t& seed, Tuple const& tuple)
+    {
+      hash_combine(seed, std::get<0>(tuple));
+    }
+  };
+
   template <typename ... TT>
   struct hash<std::tuple<TT...>>
   {
@@ -54,6 +259,8 @@ namespace hash_tuple {
       }
   };
 
+} // namespace legacy
+
 }
 
 #endif // HASH_TUPLE_H
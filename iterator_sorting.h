@@ -8,6 +8,18 @@
 //
 // * Duplicate removal:
 //   * `stable_uniquify()`
+//   * `unstable_uniquify()` (in-place, no index memory)
+//   * `sorted_uniquify()`
+//   * `merge_uniquify()` (adding a batch to an already-deduplicated vector)
+//   * `fingerprint_unique_iterators()` (radix sort of hashes, for large keys)
+//   * `stable_unique_iterators_by()`, `stable_uniquify_by()`
+//     (kernel chosen at compile time from the key type, see `key_traits.h`;
+//     run boundaries of radix keys are found with SIMD, see `simd_kernels.h`)
+// * Deduplication against a reference range:
+//   * `unique_difference()`
+//   * `unique_intersection()`
+// * Reordering a container by an array of its iterators:
+//   * `apply_permutation()`
 //
 // Based on:
 // https://stackoverflow.com/questions/12200486/how-to-remove-duplicates-from-unsorted-stdvector-while-keeping-the-original-or/15761097#15761097
@@ -17,14 +29,26 @@
 // when there is only a low number of duplicates in the input.
 //
 // This is because a sorting vectors has good cache locality,
-// while (hash) sets require random memory access for each element.
+// while (hash) sets require random memory access for each element
+// (`./bench --perf` shows the cache and TLB misses per element of each).
 //
 // In the case the input consists mostly of duplicates, using a (hash) set can
 // be faster, especially when the set can fit into a fast CPU cache.
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
 #include <vector>
 
+#include "hash_tuple.h"
+#include "key_traits.h"
+#include "simd_kernels.h"
+
 namespace iterator_sorting {
 
 // Returns an array of iterators that would sort the pointed-to values (unstable sort).
@@ -95,11 +119,106 @@ stable_unique_iterators(
   return v;
 }
 
+namespace detail {
+
+// Swaps the values pointed to by `uniqIts` (which must be in ascending order)
+// to the front of `[begin, end)`, preserving their order.
+// Returns the end of the front region.
+template <typename It>
+It
+swap_to_front(const It begin, const It end, const std::vector<It> & uniqIts)
+{
+  // Apply the order of uniqIts to the underlying container:
+  // For each of the container's iterators, swap its pointed-to value
+  // to the end of the uniq'ed region the iterator is the next unique one.
+  It uniqueRegionEnd = begin; // Everthing until here has already been unique-swapped.
+  size_t j = 0;
+  for (It it = begin; it != end && j != uniqIts.size(); ++it) {
+    if (it == uniqIts[j]) {
+      std::iter_swap(it, uniqueRegionEnd);
+      ++j;
+      ++uniqueRegionEnd;
+    }
+  }
+  return uniqueRegionEnd;
+}
+
+// Up to this many elements, `stable_uniquify()` compares each element
+// with the uniques found so far, in-place.
+inline constexpr size_t tiny_uniquify_threshold = 16;
+
+// Up to this many elements, `stable_uniquify()` and `stable_uniquify_by()`
+// work in fixed-size stack buffers of 16-bit offsets instead of heap-allocated
+// iterator vectors. This is where per-call allocation and the 8 bytes per
+// iterator matter most relative to the actual work; it covers the sizes
+// 1000-10000 at which index sorting otherwise loses to hash sets.
+// The buffers take 48 KB of stack (`stable_uniquify()`) or 64 KB (the hash
+// table of `stable_uniquify_by()`, 2 slots per element); 16-bit offsets
+// would allow up to 32768.
+inline constexpr size_t small_uniquify_threshold = 16384;
+
+// `stable_uniquify()` for up to `tiny_uniquify_threshold` elements:
+// O(N^2) comparisons, no additional memory.
+template <typename It, typename EqualPred>
+It
+tiny_stable_uniquify(const It begin, const It end, EqualPred & equalPred)
+{
+  It uniqueRegionEnd = begin;
+  for (It it = begin; it != end; ++it) {
+    bool seen = false;
+    for (It u = begin; u != uniqueRegionEnd && !seen; ++u)
+      seen = equalPred(*u, *it);
+    if (!seen) {
+      std::iter_swap(it, uniqueRegionEnd);
+      ++uniqueRegionEnd;
+    }
+  }
+  return uniqueRegionEnd;
+}
+
+// `stable_uniquify()` for up to `small_uniquify_threshold` elements:
+// index sort of 16-bit offsets in a stack buffer. Ties are broken by offset,
+// so `std::sort` (which, unlike `std::stable_sort`, never allocates) suffices.
+template <typename It, typename Compare, typename EqualPred>
+It
+small_stable_uniquify(const It begin, const size_t n, Compare & comp, EqualPred & equalPred)
+{
+  std::array<uint16_t, small_uniquify_threshold> order;
+  for (size_t i = 0; i < n; ++i)
+    order[i] = static_cast<uint16_t>(i);
+  const auto at = [begin](uint16_t i) -> decltype(auto) { return begin[static_cast<std::ptrdiff_t>(i)]; };
+  std::sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(n), [&](uint16_t a, uint16_t b) {
+    if (comp(at(a), at(b))) return true;
+    if (comp(at(b), at(a))) return false;
+    return a < b;
+  });
+
+  std::array<bool, small_uniquify_threshold> isUnique{};
+  for (size_t k = 0; k < n; ++k)
+    isUnique[order[k]] = k == 0 || !equalPred(at(order[k - 1]), at(order[k]));
+
+  It uniqueRegionEnd = begin;
+  It it = begin;
+  for (size_t i = 0; i < n; ++i, ++it) {
+    if (isUnique[i]) {
+      std::iter_swap(it, uniqueRegionEnd);
+      ++uniqueRegionEnd;
+    }
+  }
+  return uniqueRegionEnd;
+}
+
+} // namespace detail
+
 // Partitions the range `[begin, end)` into two groups: Unique elements, and duplicates.
 // Returns an iterator `uniqueRegionEnd` such the two groups are
 // `[begin, uniqueRegionEnd)` and `[uniqueRegionEnd, end)`.
 // Preserves stable order.
 //
+// Small ranges are handled without heap allocation: up to
+// `detail::tiny_uniquify_threshold` elements by pairwise comparison, and up to
+// `detail::small_uniquify_threshold` elements by sorting offsets on the stack.
+//
 // Complexity:
 // Given `N` as `last - first`:
 // * Same as `std::stable_sort` for N elements
@@ -118,21 +237,14 @@ stable_uniquify(
   EqualPred equalPred = EqualPred{}
 )
 {
-  const std::vector<It> uniqIts = stable_unique_iterators(begin, end, comp, equalPred);
+  const size_t n = static_cast<size_t>(std::distance(begin, end));
+  if (n <= detail::tiny_uniquify_threshold)
+    return detail::tiny_stable_uniquify(begin, end, equalPred);
+  if (n <= detail::small_uniquify_threshold)
+    return detail::small_stable_uniquify(begin, n, comp, equalPred);
 
-  // Apply the order of uniqIts to the underlying container:
-  // For each of the container's iterators, swap its pointed-to value
-  // to the end of the uniq'ed region the iterator is the next unique one.
-  It uniqueRegionEnd = begin; // Everthing until here has already been unique-swapped.
-  size_t j = 0;
-  for (It it = begin; it != end && j != uniqIts.size(); ++it) {
-    if (it == uniqIts[j]) {
-      std::iter_swap(it, uniqueRegionEnd);
-      ++j;
-      ++uniqueRegionEnd;
-    }
-  }
-  return uniqueRegionEnd;
+  const std::vector<It> uniqIts = stable_unique_iterators(begin, end, comp, equalPred);
+  return detail::swap_to_front(begin, end, uniqIts);
 }
 
 // Removes duplicate elements form a vector. Preserves stable order.
@@ -154,6 +266,808 @@ stable_uniquify(std::vector<T> & v)
   );
 }
 
+// Rearranges the range `[begin, begin + order.size())` such that afterwards,
+// position `i` holds the value that `order[i]` pointed to before.
+// `order` must be a permutation of the iterators of that range
+// (for example as returned by sorting a vector of iterators).
+//
+// Follows the cycles of the permutation, so every element is moved exactly once,
+// plus one move into a temporary per cycle. This is cheaper than applying the
+// permutation by swaps (3 moves each) or by copying into a new container,
+// which matters for large `T`.
+//
+// Complexity:
+// Given `N` as `order.size()`:
+// * O(N) element moves
+// * N bits additional memory to track already-placed positions
+template <typename It>
+void
+apply_permutation(const It begin, const std::vector<It> & order)
+{
+  const size_t n = order.size();
+  std::vector<bool> placed(n, false);
+  for (size_t start = 0; start < n; ++start) {
+    if (placed[start]) continue;
+    placed[start] = true;
+    size_t src = static_cast<size_t>(order[start] - begin);
+    if (src == start) continue; // fixed point, nothing to move
+
+    // Walk the cycle, pulling each position's new value into it.
+    typename std::iterator_traits<It>::value_type tmp = std::move(begin[static_cast<std::ptrdiff_t>(start)]);
+    size_t dst = start;
+    while (src != start) {
+      begin[static_cast<std::ptrdiff_t>(dst)] = std::move(begin[static_cast<std::ptrdiff_t>(src)]);
+      placed[src] = true;
+      dst = src;
+      src = static_cast<size_t>(order[dst] - begin);
+    }
+    begin[static_cast<std::ptrdiff_t>(dst)] = std::move(tmp);
+  }
+}
+
+// Partitions the range `[begin, end)` into two groups: Unique elements, and duplicates.
+// Returns an iterator `uniqueRegionEnd` such the two groups are
+// `[begin, uniqueRegionEnd)` and `[uniqueRegionEnd, end)`.
+// The unique elements are in sorted order; of each group of equal elements,
+// the first one in the original order is kept.
+//
+// Unlike `unstable_uniquify()`, elements are not moved during sorting;
+// they are moved once at the end by `apply_permutation()`.
+//
+// Complexity:
+// Given `N` as `last - first`:
+// * Same as `std::stable_sort` for N elements
+// * O(N) element moves
+// * O(N) additional memory for iterators
+template <
+  typename It,
+  typename Compare = std::less<>,
+  typename EqualPred = std::equal_to<>
+>
+It
+sorted_uniquify(
+  const It begin,
+  const It end,
+  Compare comp = Compare{},
+  EqualPred equalPred = EqualPred{}
+)
+{
+  // Create vector of iterators.
+  std::vector<It> v;
+  v.reserve(static_cast<size_t>(std::distance(begin, end)));
+  for (It it = begin; it != end; ++it)
+    v.push_back(it);
+
+  // Sort vector of iterators so that their pointed-to values are in order,
+  // with the first occurrence of each value first among its equals.
+  std::stable_sort(v.begin(), v.end(), [&comp](const It & a, const It &b ){ return comp(*a, *b); });
+
+  // Build the complete target order: run heads (the uniques) first, then the rest.
+  std::vector<bool> isUnique(v.size());
+  size_t numUniques = 0;
+  for (size_t i = 0; i < v.size(); ++i) {
+    isUnique[i] = i == 0 || !equalPred(*v[i - 1], *v[i]);
+    numUniques += isUnique[i];
+  }
+  std::vector<It> order(v.size());
+  size_t u = 0;
+  size_t d = numUniques;
+  for (size_t i = 0; i < v.size(); ++i) {
+    order[isUnique[i] ? u++ : d++] = v[i];
+  }
+  v = std::vector<It>(); // free before moving elements
+
+  apply_permutation(begin, order);
+  return std::next(begin, static_cast<std::ptrdiff_t>(numUniques));
+}
+
+// Removes duplicate elements from a vector, leaving the remaining ones sorted.
+//
+// Complexity:
+// Given `N` as `last - first`:
+// * Same as `std::stable_sort` for N elements
+// * O(N) additional memory for iterators
+template <typename T>
+std::vector<T>::iterator
+sorted_uniquify(std::vector<T> & v)
+{
+  return v.erase(sorted_uniquify(v.begin(), v.end()), v.end());
+}
+
+// Returns indices into `v` in the order that would sort its values.
+// This is the `sortedIndex` that `merge_uniquify()` maintains.
+//
+// Complexity:
+// Given `N` as `v.size()`:
+// * Same as `std::sort` for N elements
+template <typename T, typename Compare = std::less<>>
+std::vector<size_t>
+sorted_indices(const std::vector<T> & v, Compare comp = Compare{})
+{
+  std::vector<size_t> index(v.size());
+  for (size_t i = 0; i < v.size(); ++i)
+    index[i] = i;
+  std::sort(index.begin(), index.end(), [&v, &comp](size_t a, size_t b){ return comp(v[a], v[b]); });
+  return index;
+}
+
+// Adds to the already-deduplicated vector `base` those elements of the batch
+// `[batchBegin, batchEnd)` that are not yet present in it,
+// without re-deduplicating `base`.
+//
+// Preconditions:
+// * `base` contains no duplicates.
+// * `sortedIndex` is the index of `base` sorted by `comp`, as returned by
+//   `sorted_indices()` or a previous call of this function.
+// * The batch does not point into `base`.
+//
+// New elements are appended in the order of their first occurrence in the batch.
+// `sortedIndex` is updated to include them.
+// Returns an iterator to the first appended element in `base`
+// (equal to `base.end()` if nothing was new).
+//
+// Complexity:
+// Given `B` as `batchEnd - batchBegin` and `N` as `base.size()`:
+// * Same as `std::stable_sort` for B elements
+// * O(N + B) comparisons for merging
+// * O(N + B) additional memory for indices
+template <
+  typename T,
+  typename It,
+  typename Compare = std::less<>,
+  typename EqualPred = std::equal_to<>
+>
+std::vector<T>::iterator
+merge_uniquify(
+  std::vector<T> & base,
+  std::vector<size_t> & sortedIndex,
+  const It batchBegin,
+  const It batchEnd,
+  Compare comp = Compare{},
+  EqualPred equalPred = EqualPred{}
+)
+{
+  // Deduplicate the batch on its own, keeping first occurrences (in value order).
+  std::vector<It> batch;
+  batch.reserve(static_cast<size_t>(std::distance(batchBegin, batchEnd)));
+  for (It it = batchBegin; it != batchEnd; ++it)
+    batch.push_back(it);
+  std::stable_sort(batch.begin(), batch.end(), [&comp](const It & a, const It &b ){ return comp(*a, *b); });
+  batch.erase(std::unique(batch.begin(), batch.end(), [&equalPred](const It & a, const It & b) { return equalPred(*a, *b); }), batch.end());
+
+  // Walk both sorted sequences to find the batch values missing from `base`.
+  std::vector<It> newIts; // in value order
+  size_t i = 0;
+  for (const It & it : batch) {
+    while (i < sortedIndex.size() && comp(base[sortedIndex[i]], *it))
+      ++i;
+    if (!(i < sortedIndex.size() && equalPred(base[sortedIndex[i]], *it)))
+      newIts.push_back(it);
+  }
+
+  // Append the new values in batch order.
+  std::vector<It> appendOrder = newIts;
+  std::sort(appendOrder.begin(), appendOrder.end());
+  const size_t oldSize = base.size();
+  base.reserve(oldSize + appendOrder.size());
+  for (const It & it : appendOrder)
+    base.push_back(*it);
+
+  // Merge the new values' indices (already in value order) into the sorted index.
+  std::vector<size_t> newIndex;
+  newIndex.reserve(newIts.size());
+  for (const It & it : newIts)
+    newIndex.push_back(oldSize + static_cast<size_t>(std::lower_bound(appendOrder.begin(), appendOrder.end(), it) - appendOrder.begin()));
+  std::vector<size_t> merged(sortedIndex.size() + newIndex.size());
+  std::merge(
+    sortedIndex.begin(), sortedIndex.end(),
+    newIndex.begin(), newIndex.end(),
+    merged.begin(),
+    [&base, &comp](size_t a, size_t b){ return comp(base[a], base[b]); }
+  );
+  sortedIndex = std::move(merged);
+
+  return base.begin() + static_cast<std::ptrdiff_t>(oldSize);
+}
+
+namespace detail {
+
+// Returns iterators to the elements `i` with `isUnique[i]`, in index order.
+template <typename It, typename Marks>
+std::vector<It>
+collect_marked(const It begin, const size_t n, const Marks & isUnique)
+{
+  // Collect survivors in index order; no need to sort back.
+  std::vector<It> v;
+  v.reserve(n);
+  It it = begin;
+  for (size_t i = 0; i < n; ++i, ++it) {
+    if (isUnique[i])
+      v.push_back(it);
+  }
+  return v;
+}
+
+// Sorts `records` by the 64-bit unsigned `key(record)`.
+// LSD radix sort with 8-bit digits; stable.
+// Passes in which all records share the same digit are skipped,
+// so keys with few significant bits take fewer passes;
+// already sorted input is detected and left alone.
+//
+// Complexity:
+// Given `N` as `records.size()`:
+// * O(N) per pass, at most 8 passes; O(N) for sorted input
+// * O(N) additional memory for the scatter buffer
+template <typename Record, typename Key>
+void
+radix_sort_u64(std::vector<Record> & records, Key key)
+{
+  const size_t n = records.size();
+  if (n < 2) return;
+  if (std::is_sorted(records.begin(), records.end(), [&key](const Record & a, const Record & b){ return key(a) < key(b); }))
+    return;
+
+  // Histograms of all 8 digits in a single read pass.
+  std::vector<size_t> counts(8 * 256, 0);
+  for (const Record & r : records) {
+    const uint64_t k = key(r);
+    for (size_t d = 0; d < 8; ++d)
+      ++counts[d * 256 + ((k >> (8 * d)) & 0xff)];
+  }
+
+  std::vector<Record> buffer(n);
+  for (size_t d = 0; d < 8; ++d) {
+    size_t * const count = &counts[d * 256];
+    if (count[(key(records[0]) >> (8 * d)) & 0xff] == n)
+      continue; // all records have the same digit; the pass would not change the order
+    size_t offset = 0;
+    for (size_t b = 0; b < 256; ++b) {
+      const size_t c = count[b];
+      count[b] = offset;
+      offset += c;
+    }
+    for (Record & r : records)
+      buffer[count[(key(r) >> (8 * d)) & 0xff]++] = std::move(r);
+    records.swap(buffer);
+  }
+}
+
+} // namespace detail
+
+// Returns an array of iterators to the first occurrences of the distinct values
+// in `[begin, end)`, in their original order (like `stable_unique_iterators()`).
+//
+// Instead of comparison-sorting by value, this radix-sorts
+// `(hash(value), index)` pairs, so the `O(N log(N))` part of the work
+// never touches the values. Only elements whose hashes collide are compared
+// with `equalPred`, so the result is exact for any `hash`; a poor hash only
+// costs time. This pays off for large keys, where each comparison in an index
+// sort touches whole cache lines.
+//
+// `hash(value)` must return the same value for values that are `equalPred`-equal.
+//
+// Complexity:
+// Given `N` as `last - first`:
+// * N applications of `hash`
+// * O(N) for the radix sort
+// * For each group of G elements with equal hash, O(G^2) applications of `equalPred`
+//   in the worst case (G = 1 for distinct values under a good hash)
+// * O(N) additional memory for `(hash, index)` pairs
+template <
+  typename It,
+  typename Hash,
+  typename EqualPred = std::equal_to<>
+>
+std::vector<It>
+fingerprint_unique_iterators(
+  const It begin,
+  const It end,
+  Hash hash,
+  EqualPred equalPred = EqualPred{}
+)
+{
+  struct Fingerprint
+  {
+    uint64_t hash;
+    size_t index;
+  };
+
+  // Create vector of fingerprints, in index order.
+  const size_t n = static_cast<size_t>(std::distance(begin, end));
+  std::vector<Fingerprint> fps;
+  fps.reserve(n);
+  {
+    size_t i = 0;
+    for (It it = begin; it != end; ++it, ++i)
+      fps.push_back({static_cast<uint64_t>(hash(*it)), i});
+  }
+
+  // Stable sort keeps each run of equal hashes in index order.
+  detail::radix_sort_u64(fps, [](const Fingerprint & f){ return f.hash; });
+
+  // Within each run of equal hashes, an element is a duplicate iff it equals
+  // an earlier (hence lower-index) unique of the same run.
+  std::vector<bool> isUnique(n, true);
+  for (size_t runBegin = 0; runBegin < n; ) {
+    size_t runEnd = runBegin + 1;
+    while (runEnd < n && fps[runEnd].hash == fps[runBegin].hash)
+      ++runEnd;
+    for (size_t i = runBegin + 1; i < runEnd; ++i) {
+      const auto & value = begin[static_cast<std::ptrdiff_t>(fps[i].index)];
+      for (size_t j = runBegin; j < i; ++j) {
+        if (isUnique[fps[j].index] && equalPred(begin[static_cast<std::ptrdiff_t>(fps[j].index)], value)) {
+          isUnique[fps[i].index] = false;
+          break;
+        }
+      }
+    }
+    runBegin = runEnd;
+  }
+
+  return detail::collect_marked(begin, n, isUnique);
+}
+
+namespace detail {
+
+// Record of a key extracted from element number `index`,
+// so that sorting it does not need to follow iterators.
+// Records for `mark_run_heads_simd()` use a `uint64_t` index, so that they
+// consist of 64-bit words also where `size_t` is narrower.
+template <typename Key, typename Index = size_t>
+struct KeyRecord
+{
+  Key key;
+  Index index;
+};
+
+// Given `records` sorted by key and, within equal keys, by index,
+// returns iterators to the run heads (the first occurrences) in index order.
+template <typename It, typename Record, typename KeyEqual>
+std::vector<It>
+collect_run_heads(const It begin, const size_t n, const std::vector<Record> & records, KeyEqual keyEqual)
+{
+  std::vector<bool> isUnique(n, false);
+  for (size_t i = 0; i < records.size(); ++i) {
+    if (i == 0 || !keyEqual(records[i - 1], records[i]))
+      isUnique[records[i].index] = true;
+  }
+  return collect_marked(begin, n, isUnique);
+}
+
+// Like `collect_run_heads()`, for records consisting of 64-bit words,
+// whose keys are the words at the offsets `keyWords` and whose `index` is a
+// `uint64_t` (see `KeyRecord`), but marking the
+// run heads in `isUnique` instead of collecting them.
+// Run boundaries are found by the vectorised `compact_run_heads()`,
+// in blocks of positions; `onTies(blockBegin, blockEnd)` is called for each
+// block `[blockBegin, blockEnd)` that is not made of run heads only.
+template <typename Record, typename OnTies>
+void
+mark_run_heads_simd(const std::vector<Record> & records, const size_t * keyWords, const size_t numKeyWords, std::vector<bool> & isUnique, OnTies onTies)
+{
+  static_assert(std::is_standard_layout_v<Record> && sizeof(Record) % sizeof(uint64_t) == 0);
+  static_assert(sizeof(Record::index) == sizeof(uint64_t));
+  const record_layout layout{
+    reinterpret_cast<const uint64_t *>(records.data()),
+    sizeof(Record) / sizeof(uint64_t),
+    keyWords,
+    numKeyWords,
+    offsetof(Record, index) / sizeof(uint64_t),
+  };
+
+  // Compress block-wise into a buffer that stays in L1 cache.
+  constexpr size_t blockSize = 1024;
+  std::array<uint64_t, blockSize + compact_run_heads_slack> heads;
+  for (size_t blockBegin = 0; blockBegin < records.size(); blockBegin += blockSize) {
+    const size_t blockEnd = std::min(blockBegin + blockSize, records.size());
+    const size_t numHeads = compact_run_heads(layout, blockBegin, blockEnd, heads.data());
+    for (size_t k = 0; k < numHeads; ++k)
+      isUnique[static_cast<size_t>(heads[k])] = true;
+    if (numHeads != blockEnd - blockBegin)
+      onTies(blockBegin, blockEnd);
+  }
+}
+
+// Kernel for `key_kind::radix` keys.
+//
+// Radix sorts `(word, index)` records of only the leading key word that varies
+// across the input (words before it are the same in all keys), which moves
+// half or less of the data a radix sort of whole encoded keys would.
+// Run heads of the leading words are found with the SIMD `compact_run_heads()`.
+// Runs longer than one are then resolved by comparison sorting their
+// whole encoded keys (unless no other word varies); for keys that vary in
+// their leading word, such as most real coordinates, these runs are rare,
+// short or consist of duplicates, and blocks without them are skipped.
+template <typename It, typename Key, typename Proj>
+std::vector<It>
+radix_unique_iterators(const It begin, const It end, Proj & proj)
+{
+  constexpr size_t W = key_traits<Key>::words;
+  using Words = std::array<uint64_t, W>;
+  const auto encodeAt = [&proj](const It it) {
+    Words words;
+    key_traits<Key>::encode(std::invoke(proj, *it), words.data());
+    return words;
+  };
+
+  const size_t n = static_cast<size_t>(std::distance(begin, end));
+  if (n == 0) return {};
+
+  // Find the words that vary; stops early once all of them do.
+  std::array<bool, W> varies{};
+  {
+    const Words first = encodeAt(begin);
+    size_t numVarying = 0;
+    for (It it = std::next(begin); it != end && numVarying < W; ++it) {
+      const Words words = encodeAt(it);
+      for (size_t w = 0; w < W; ++w) {
+        if (!varies[w] && words[w] != first[w]) {
+          varies[w] = true;
+          ++numVarying;
+        }
+      }
+    }
+  }
+  const size_t lead = static_cast<size_t>(std::find(varies.begin(), varies.end(), true) - varies.begin()) % W;
+  std::array<size_t, W> tieWords{}; // the varying words after `lead`
+  size_t numTieWords = 0;
+  for (size_t w = lead + 1; w < W; ++w) {
+    if (varies[w])
+      tieWords[numTieWords++] = w;
+  }
+
+  // Radix sorting is stable, so equal leading words stay in index order.
+  std::vector<KeyRecord<uint64_t, uint64_t>> narrow(n);
+  {
+    size_t i = 0;
+    for (It it = begin; it != end; ++it, ++i)
+      narrow[i] = {encodeAt(it)[lead], i};
+  }
+  radix_sort_u64(narrow, [](const KeyRecord<uint64_t, uint64_t> & r){ return r.key; });
+
+  // Sorts the records of the run `[runBegin, runEnd)` of equal leading words
+  // by their whole keys, and marks the heads of their runs.
+  // The run's first record has its smallest index, and is already marked.
+  std::vector<bool> isUnique(n, false);
+  std::vector<KeyRecord<Words, uint64_t>> tied;
+  const auto resolveRun = [&](const size_t runBegin, const size_t runEnd) {
+    tied.clear();
+    for (size_t k = runBegin; k < runEnd; ++k)
+      tied.push_back({encodeAt(begin + static_cast<std::ptrdiff_t>(narrow[k].index)), narrow[k].index});
+    // Indices are distinct, so ordering by them makes the unstable sort stable.
+    std::sort(tied.begin(), tied.end(), [](const KeyRecord<Words, uint64_t> & a, const KeyRecord<Words, uint64_t> & b){
+      return a.key < b.key || (a.key == b.key && a.index < b.index);
+    });
+    mark_run_heads_simd(tied, tieWords.data(), numTieWords, isUnique, [](size_t, size_t){});
+  };
+
+  // Runs before `resolvedEnd` are resolved; it is always at a run boundary.
+  size_t resolvedEnd = 0;
+  const size_t leadWord = 0;
+  mark_run_heads_simd(narrow, &leadWord, 1, isUnique, [&](const size_t blockBegin, const size_t blockEnd) {
+    if (numTieWords == 0) return;
+    // Start at the beginning of the run containing the block's first position
+    // (which may start in an earlier block consisting of run heads only).
+    size_t i = std::max(blockBegin, resolvedEnd);
+    while (i > resolvedEnd && narrow[i - 1].key == narrow[i].key)
+      --i;
+    while (i < blockEnd) {
+      size_t j = i + 1;
+      while (j < n && narrow[j].key == narrow[i].key)
+        ++j;
+      if (j - i > 1)
+        resolveRun(i, j);
+      i = j;
+    }
+    resolvedEnd = i;
+  });
+  return collect_marked(begin, n, isUnique);
+}
+
+// Kernel for `key_kind::bytes` keys.
+template <typename It, typename Key, typename Proj>
+std::vector<It>
+bytes_unique_iterators(const It begin, const It end, Proj & proj)
+{
+  using Record = KeyRecord<Key>;
+
+  const size_t n = static_cast<size_t>(std::distance(begin, end));
+  std::vector<Record> records;
+  records.reserve(n);
+  {
+    size_t i = 0;
+    for (It it = begin; it != end; ++it, ++i)
+      records.push_back({std::invoke(proj, *it), i});
+  }
+
+  std::stable_sort(records.begin(), records.end(), [](const Record & a, const Record & b){
+    return std::memcmp(&a.key, &b.key, sizeof(Key)) < 0;
+  });
+
+  return collect_run_heads(begin, n, records, [](const Record & a, const Record & b){
+    return std::memcmp(&a.key, &b.key, sizeof(Key)) == 0;
+  });
+}
+
+} // namespace detail
+
+// Returns an array of iterators to the first occurrences of the distinct
+// keys `proj(value)` in `[begin, end)`, in their original order
+// (like `stable_unique_iterators()` with comparators on `proj(value)`).
+//
+// The kernel is chosen at compile time from `key_traits` of the key type:
+// * `key_kind::radix`: keys are encoded into 64-bit words and radix sorted by their
+//   leading varying word, so no iterator indirections happen during sorting;
+//   keys equal in that word are then comparison sorted on their whole encoding.
+// * `key_kind::bytes` (opt-in only): keys are copied contiguously and sorted with `memcmp()`.
+// * `key_kind::comparison`: `stable_unique_iterators()` on `proj(value)`.
+//
+// Complexity:
+// Given `N` as `last - first`, and `W` as the number of encoded key words:
+// * radix: O(N W), at most 8 passes over N records, plus the same as `std::sort` for
+//   each run of equal leading words; 4 N words additional memory
+// * bytes: same as `std::stable_sort` for N elements; O(N) copies of keys
+// * comparison: same as `stable_unique_iterators()`
+template <typename It, typename Proj = std::identity>
+std::vector<It>
+stable_unique_iterators_by(const It begin, const It end, Proj proj = Proj{})
+{
+  using Key = std::remove_cvref_t<std::invoke_result_t<Proj &, typename std::iterator_traits<It>::reference>>;
+
+  if constexpr (radix_key<Key>) {
+    return detail::radix_unique_iterators<It, Key>(begin, end, proj);
+  } else if constexpr (bytes_key<Key>) {
+    return detail::bytes_unique_iterators<It, Key>(begin, end, proj);
+  } else {
+    return stable_unique_iterators(
+      begin,
+      end,
+      [&proj](const auto & a, const auto & b){ return std::invoke(proj, a) < std::invoke(proj, b); },
+      [&proj](const auto & a, const auto & b){ return std::invoke(proj, a) == std::invoke(proj, b); }
+    );
+  }
+}
+
+namespace detail {
+
+// `stable_uniquify_by()` for up to `small_uniquify_threshold` elements with
+// radix or bytes keys: a single pass over the range with a fixed-capacity
+// open-addressing table on the stack, holding 16-bit offsets of the uniques
+// found so far. Keys are hashed and compared through their encoding,
+// so no user-provided hash is needed.
+template <typename It, typename Key, typename Proj>
+It
+small_hash_stable_uniquify_by(const It begin, const It end, const size_t n, Proj & proj)
+{
+  const auto encodeAt = [&proj](const It it) {
+    if constexpr (radix_key<Key>) {
+      std::array<uint64_t, key_traits<Key>::words> words;
+      key_traits<Key>::encode(std::invoke(proj, *it), words.data());
+      return words;
+    } else {
+      return Key(std::invoke(proj, *it));
+    }
+  };
+
+  // Power-of-two size for a load factor of at most 1/2; 0 marks empty slots.
+  std::array<uint16_t, 2 * small_uniquify_threshold> slots;
+  size_t tableSize = 16;
+  while (tableSize < 2 * n)
+    tableSize *= 2;
+  std::fill(slots.begin(), slots.begin() + static_cast<std::ptrdiff_t>(tableSize), uint16_t{0});
+  const size_t mask = tableSize - 1;
+
+  It uniqueRegionEnd = begin;
+  size_t numUniques = 0;
+  for (It it = begin; it != end; ++it) {
+    const auto key = encodeAt(it);
+    bool seen = false;
+    size_t s = static_cast<size_t>(hash_tuple::hash_bytes(&key, sizeof(key))) & mask;
+    for ( ; slots[s] != 0; s = (s + 1) & mask) {
+      const auto other = encodeAt(begin + static_cast<std::ptrdiff_t>(slots[s] - 1));
+      if (std::memcmp(&other, &key, sizeof(key)) == 0) {
+        seen = true;
+        break;
+      }
+    }
+    if (!seen) {
+      // The table refers to uniques by their final position.
+      slots[s] = static_cast<uint16_t>(numUniques + 1);
+      std::iter_swap(it, uniqueRegionEnd);
+      ++uniqueRegionEnd;
+      ++numUniques;
+    }
+  }
+  return uniqueRegionEnd;
+}
+
+} // namespace detail
+
+// Partitions the range `[begin, end)` into two groups: Unique elements, and duplicates,
+// by the key `proj(value)`, like `stable_uniquify()`.
+// See `stable_unique_iterators_by()` for how the kernel is chosen.
+// Up to `detail::small_uniquify_threshold` elements with radix or bytes keys
+// are deduplicated with a hash table on the stack, without heap allocation.
+template <typename It, typename Proj = std::identity>
+It
+stable_uniquify_by(const It begin, const It end, Proj proj = Proj{})
+{
+  using Key = std::remove_cvref_t<std::invoke_result_t<Proj &, typename std::iterator_traits<It>::reference>>;
+
+  if constexpr (radix_key<Key> || bytes_key<Key>) {
+    const size_t n = static_cast<size_t>(std::distance(begin, end));
+    if (n <= detail::small_uniquify_threshold)
+      return detail::small_hash_stable_uniquify_by<It, Key>(begin, end, n, proj);
+  } else {
+    return stable_uniquify(
+      begin,
+      end,
+      [&proj](const auto & a, const auto & b){ return std::invoke(proj, a) < std::invoke(proj, b); },
+      [&proj](const auto & a, const auto & b){ return std::invoke(proj, a) == std::invoke(proj, b); }
+    );
+  }
+
+  const std::vector<It> uniqIts = stable_unique_iterators_by(begin, end, proj);
+  return detail::swap_to_front(begin, end, uniqIts);
+}
+
+namespace detail {
+
+// Shared implementation of `unique_difference()` and `unique_intersection()`:
+// Returns the first occurrences of values in `[begin, end)` whose presence in
+// `[refBegin, refEnd)` equals `keepPresent`, in their original order.
+template <typename It, typename RefIt, typename Compare, typename EqualPred>
+std::vector<It>
+unique_filter_by_reference(
+  const It begin,
+  const It end,
+  const RefIt refBegin,
+  const RefIt refEnd,
+  Compare comp,
+  EqualPred equalPred,
+  const bool keepPresent
+)
+{
+  // Create vectors of iterators.
+  std::vector<It> v;
+  v.reserve(static_cast<size_t>(std::distance(begin, end)));
+  for (It it = begin; it != end; ++it)
+    v.push_back(it);
+  std::vector<RefIt> ref;
+  ref.reserve(static_cast<size_t>(std::distance(refBegin, refEnd)));
+  for (RefIt it = refBegin; it != refEnd; ++it)
+    ref.push_back(it);
+
+  // Probe side: stable, so that the first occurrence heads each run of equal values.
+  // Reference side: only membership matters, so unstable suffices.
+  std::stable_sort(v.begin(), v.end(), [&comp](const It & a, const It &b ){ return comp(*a, *b); });
+  std::sort(ref.begin(), ref.end(), [&comp](const RefIt & a, const RefIt &b ){ return comp(*a, *b); });
+
+  // Walk both sorted sequences, keeping run heads by their presence in the reference.
+  std::vector<It> kept;
+  size_t r = 0;
+  for (size_t i = 0; i < v.size(); ++i) {
+    if (i != 0 && equalPred(*v[i - 1], *v[i]))
+      continue; // not a first occurrence
+    while (r < ref.size() && comp(*ref[r], *v[i]))
+      ++r;
+    const bool present = r < ref.size() && equalPred(*ref[r], *v[i]);
+    if (present == keepPresent)
+      kept.push_back(v[i]);
+  }
+
+  // Sort vector of iterators back. Its pointed-to values are now in their original order.
+  std::sort(kept.begin(), kept.end());
+  return kept;
+}
+
+} // namespace detail
+
+// Returns iterators to the first occurrences of those values in `[begin, end)`
+// that do not occur in the reference range `[refBegin, refEnd)`,
+// in their original order.
+//
+// `comp` and `equalPred` must accept both element types in either order.
+//
+// Complexity:
+// Given `N` as `end - begin` and `R` as `refEnd - refBegin`:
+// * Same as `std::stable_sort` for N elements plus `std::sort` for R elements
+// * O(N + R) additional memory for iterators
+template <
+  typename It,
+  typename RefIt,
+  typename Compare = std::less<>,
+  typename EqualPred = std::equal_to<>
+>
+std::vector<It>
+unique_difference(
+  const It begin,
+  const It end,
+  const RefIt refBegin,
+  const RefIt refEnd,
+  Compare comp = Compare{},
+  EqualPred equalPred = EqualPred{}
+)
+{
+  return detail::unique_filter_by_reference(begin, end, refBegin, refEnd, comp, equalPred, false);
+}
+
+// Returns iterators to the first occurrences of those values in `[begin, end)`
+// that also occur in the reference range `[refBegin, refEnd)`,
+// in their original order.
+//
+// `comp` and `equalPred` must accept both element types in either order.
+//
+// Complexity:
+// Given `N` as `end - begin` and `R` as `refEnd - refBegin`:
+// * Same as `std::stable_sort` for N elements plus `std::sort` for R elements
+// * O(N + R) additional memory for iterators
+template <
+  typename It,
+  typename RefIt,
+  typename Compare = std::less<>,
+  typename EqualPred = std::equal_to<>
+>
+std::vector<It>
+unique_intersection(
+  const It begin,
+  const It end,
+  const RefIt refBegin,
+  const RefIt refEnd,
+  Compare comp = Compare{},
+  EqualPred equalPred = EqualPred{}
+)
+{
+  return detail::unique_filter_by_reference(begin, end, refBegin, refEnd, comp, equalPred, true);
+}
+
+// Removes duplicate elements from the range `[begin, end)` in-place,
+// by sorting the elements themselves and then removing adjacent equal ones.
+// Returns an iterator `uniqueRegionEnd` such that `[begin, uniqueRegionEnd)`
+// contains each distinct element once, in sorted (not original) order.
+// The contents of `[uniqueRegionEnd, end)` are valid but unspecified.
+//
+// Unlike the index-based functions above, this needs no `O(N)` iterator vector,
+// which makes it the choice when memory is tight and the order does not matter.
+// It moves whole elements `O(N log(N))` times though, so it loses its
+// advantage over index sorting as `sizeof(T)` grows relative to the compared part.
+//
+// Complexity:
+// Given `N` as `last - first`:
+// * Same as `std::sort` for N elements (O(N log(N)) comparisons), plus N - 1 applications of `equalPred`
+// * Additional memory as used by `std::sort`, which the standard does not bound;
+//   O(log(N)) stack and no heap allocation in libstdc++, libc++ and MSVC's STL
+template <
+  typename It,
+  typename Compare = std::less<>,
+  typename EqualPred = std::equal_to<>
+>
+It
+unstable_uniquify(
+  const It begin,
+  const It end,
+  Compare comp = Compare{},
+  EqualPred equalPred = EqualPred{}
+)
+{
+  // `std::sort` is O(N log(N)); `std::unique` is one pass.
+  std::sort(begin, end, comp);
+  return std::unique(begin, end, equalPred);
+}
+
+// Removes duplicate elements from a vector in-place. Does not preserve order.
+//
+// Complexity:
+// Given `N` as `last - first`:
+// * Same as `std::sort` for N elements
+// * Additional memory as used by `std::sort`
+template <typename T>
+std::vector<T>::iterator
+unstable_uniquify(std::vector<T> & v)
+{
+  return v.erase(unstable_uniquify(v.begin(), v.end()), v.end());
+}
+
 } // namespace
 
 #endif // ITERATOR_SORTING_H
@@ -0,0 +1,200 @@
+#ifndef KEY_TRAITS_H
+#define KEY_TRAITS_H
+
+// Compile-time classification of the key types that elements are deduplicated by
+// (the result of the projection function `proj()`), so that
+// `iterator_sorting::stable_unique_iterators_by()` can statically pick
+// a kernel that is correct for the key type, and as fast as the key allows:
+//
+// * `key_kind::radix`: The key can be encoded into a fixed number of 64-bit words,
+//   such that two keys are equal exactly if their encodings are equal,
+//   and encodings compare lexicographically like the keys do.
+//   Deduplicated by LSD radix sort of the leading word that varies across the input,
+//   then comparison sort of the whole encodings of keys that are equal in it.
+//   Provided for: arithmetic types, `std::array`s of bytes or of radix keys,
+//   `std::pair`s and `std::tuple`s of radix keys.
+// * `key_kind::bytes`: The key's object representation identifies it
+//   (trivially copyable without padding, e.g. plain structs of integers).
+//   Deduplicated by sorting copies of the keys with `memcmp()`.
+//   Never chosen automatically, because it bypasses the key's own
+//   `operator<` and `operator==`; see `bytes_key_traits` to opt in.
+// * `key_kind::comparison`: Anything else (e.g. `std::string`, user structs).
+//   Deduplicated by sorting iterators with `operator<` and `operator==`.
+//
+// Users can specialise `key_traits` for their own key types, for example:
+//
+//     template <>
+//     struct iterator_sorting::key_traits<MyPos>
+//     {
+//       static constexpr key_kind kind = key_kind::radix;
+//       static constexpr size_t words = 2;
+//       static void encode(const MyPos & p, uint64_t * out) { out[0] = p.cell; out[1] = p.offset; }
+//     };
+//
+// or, for a key whose equality is exactly equality of its bytes:
+//
+//     template <>
+//     struct iterator_sorting::key_traits<MyId> : iterator_sorting::bytes_key_traits<MyId> {};
+//
+// Notes on floating point: `-0.0` and `0.0` are encoded equally (they compare equal).
+// NaNs never compare equal, but NaNs with identical bits get identical encodings,
+// so radix-kind deduplication treats them as duplicates of each other.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace iterator_sorting {
+
+enum class key_kind { comparison, bytes, radix };
+
+// Primary template: keys that can only be compared.
+template <typename Key>
+struct key_traits
+{
+  static constexpr key_kind kind = key_kind::comparison;
+};
+
+template <typename Key>
+concept radix_key = key_traits<Key>::kind == key_kind::radix;
+
+template <typename Key>
+concept bytes_key = key_traits<Key>::kind == key_kind::bytes;
+
+namespace detail {
+
+template <typename T>
+inline constexpr bool is_byte_like_v =
+  std::is_same_v<T, unsigned char> || std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, std::byte>;
+
+// Order-preserving encodings of single arithmetic values.
+
+template <typename T>
+uint64_t
+encode_arithmetic(const T x)
+{
+  if constexpr (std::is_floating_point_v<T>) {
+    double d = static_cast<double>(x); // exact for float and double
+    if (d == 0) d = 0; // canonicalise -0.0
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    // Positive numbers: set the sign bit to order them above negatives.
+    // Negative numbers: flip all bits to reverse their magnitude order.
+    return (bits >> 63) ? ~bits : bits | (uint64_t{1} << 63);
+  } else if constexpr (std::is_signed_v<T>) {
+    return static_cast<uint64_t>(static_cast<int64_t>(x)) ^ (uint64_t{1} << 63);
+  } else {
+    return static_cast<uint64_t>(x);
+  }
+}
+
+} // namespace detail
+
+// Arithmetic types of up to 64 bits.
+template <typename Key>
+  requires std::is_arithmetic_v<Key> && (sizeof(Key) <= sizeof(uint64_t))
+struct key_traits<Key>
+{
+  static constexpr key_kind kind = key_kind::radix;
+  static constexpr size_t words = 1;
+  static void encode(const Key & k, uint64_t * out) { out[0] = detail::encode_arithmetic(k); }
+};
+
+// Base for opting a key type into `key_kind::bytes` by specialising `key_traits`.
+// Only valid if two keys are equal exactly if their bytes are.
+template <typename Key>
+struct bytes_key_traits
+{
+  static_assert(std::is_trivially_copyable_v<Key> && std::has_unique_object_representations_v<Key>,
+    "key_kind::bytes requires a trivially copyable key without padding");
+  static constexpr key_kind kind = key_kind::bytes;
+};
+
+// Fixed-size byte arrays: packed big-endian, 8 bytes per word.
+// Signed bytes (including `char` where it is signed) are biased by 0x80,
+// so that negative ones order before positive ones.
+template <typename T, size_t N>
+  requires detail::is_byte_like_v<T>
+struct key_traits<std::array<T, N>>
+{
+  static constexpr key_kind kind = key_kind::radix;
+  static constexpr size_t words = (N + 7) / 8;
+  static void encode(const std::array<T, N> & k, uint64_t * out)
+  {
+    constexpr unsigned char bias = std::is_signed_v<T> ? 0x80 : 0;
+    for (size_t w = 0; w < words; ++w) {
+      uint64_t word = 0;
+      for (size_t b = 0; b < 8; ++b) {
+        const size_t i = w * 8 + b;
+        word = (word << 8) | (i < N ? static_cast<uint64_t>(static_cast<unsigned char>(static_cast<unsigned char>(k[i]) ^ bias)) : 0);
+      }
+      out[w] = word;
+    }
+  }
+};
+
+// Fixed-size arrays of radix keys.
+template <typename T, size_t N>
+  requires (!detail::is_byte_like_v<T>) && radix_key<T>
+struct key_traits<std::array<T, N>>
+{
+  static constexpr key_kind kind = key_kind::radix;
+  static constexpr size_t words = N * key_traits<T>::words;
+  static void encode(const std::array<T, N> & k, uint64_t * out)
+  {
+    for (size_t i = 0; i < N; ++i)
+      key_traits<T>::encode(k[i], out + i * key_traits<T>::words);
+  }
+};
+
+// Tuples of radix keys, e.g. `tuple<double, double, double>`.
+template <typename ... Ts>
+  requires (radix_key<Ts> && ...)
+struct key_traits<std::tuple<Ts...>>
+{
+  static constexpr key_kind kind = key_kind::radix;
+  static constexpr size_t words = (key_traits<Ts>::words + ... + 0);
+  static void encode(const std::tuple<Ts...> & k, uint64_t * out)
+  {
+    std::apply([&out](const Ts & ... elems) {
+      ((key_traits<Ts>::encode(elems, out), out += key_traits<Ts>::words), ...);
+    }, k);
+  }
+};
+
+// Pairs of radix keys.
+template <typename A, typename B>
+  requires radix_key<A> && radix_key<B>
+struct key_traits<std::pair<A, B>>
+{
+  static constexpr key_kind kind = key_kind::radix;
+  static constexpr size_t words = key_traits<A>::words + key_traits<B>::words;
+  static void encode(const std::pair<A, B> & k, uint64_t * out)
+  {
+    key_traits<A>::encode(k.first, out);
+    key_traits<B>::encode(k.second, out + key_traits<A>::words);
+  }
+};
+
+// Strings are variable-length; they are compared.
+template <typename CharT, typename Traits, typename Allocator>
+struct key_traits<std::basic_string<CharT, Traits, Allocator>>
+{
+  static constexpr key_kind kind = key_kind::comparison;
+};
+
+template <typename CharT, typename Traits>
+struct key_traits<std::basic_string_view<CharT, Traits>>
+{
+  static constexpr key_kind kind = key_kind::comparison;
+};
+
+} // namespace iterator_sorting
+
+#endif // KEY_TRAITS_H
@@ -0,0 +1,281 @@
+#ifndef PARALLEL_UNIQUIFY_H
+#define PARALLEL_UNIQUIFY_H
+
+// Multi-threaded hash-based duplicate removal.
+//
+// Provides:
+//
+// * `concurrent_hash_unique_iterators()`: all threads insert into one shared
+//   lock-free `concurrent_index_set`.
+// * `sharded_hash_unique_iterators()`: each thread deduplicates its own chunk
+//   into thread-local tables (no atomics), which are then merged per shard.
+//
+// Results are deterministic: like `stable_unique_iterators()`, the first
+// occurrence of each distinct value is kept, in original order,
+// independent of the number of threads and their timing.
+//
+// All parallel phases run on the shared `default_scheduler()` (see `task_scheduler.h`);
+// `numThreads` sets how many chunks the work is split into,
+// with 0 meaning the scheduler's concurrency. Chunks have at least
+// `parallel_grain` elements, so small inputs run on the calling thread only.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#include "concurrent_index_set.h"
+#include "iterator_sorting.h"
+#include "task_scheduler.h"
+
+namespace iterator_sorting {
+
+namespace detail {
+
+// Minimum number of elements per chunk. Below this, scheduling a task and
+// sharing the tables costs more than the chunk saves.
+inline constexpr size_t parallel_grain = 16384;
+
+// Number of chunks to split `n` elements into for `numThreads` (0: the scheduler's concurrency).
+inline size_t
+resolve_num_threads(const size_t numThreads, const size_t n)
+{
+  const size_t threads = numThreads != 0 ? numThreads : default_scheduler().concurrency();
+  return std::max<size_t>(1, std::min(threads, n / parallel_grain));
+}
+
+// Runs `f(chunkBegin, chunkEnd)` for `numChunks` contiguous chunks covering `[0, n)`,
+// in parallel on the library's `default_scheduler()`.
+template <typename F>
+void
+parallel_chunks(const size_t n, const size_t numChunks, F f)
+{
+  const size_t chunks = std::max<size_t>(1, std::min(numChunks, n));
+  default_scheduler().parallel_for(chunks, [&f, n, chunks](size_t c){ f(n * c / chunks, n * (c + 1) / chunks); });
+}
+
+// Single-threaded open-addressing (linear probing) hash set of element indices,
+// storing each index with its hash. Grows to keep the load factor at most 1/2.
+class index_table
+{
+public:
+  // Inserts `index` with hash `hash` unless an element equal to it by
+  // `indexEqual(storedIndex, index)` is present. Returns true if inserted.
+  template <typename IndexEqual>
+  bool
+  insert(const uint64_t hash, const size_t index, IndexEqual & indexEqual)
+  {
+    if (2 * (size_ + 1) > slots_.size())
+      grow();
+    const size_t mask = slots_.size() - 1;
+    for (size_t s = hash & mask; ; s = (s + 1) & mask) {
+      Slot & slot = slots_[s];
+      if (slot.index == empty) {
+        slot = {hash, index};
+        ++size_;
+        return true;
+      }
+      if (slot.hash == hash && indexEqual(slot.index, index))
+        return false;
+    }
+  }
+
+  // Calls `f(hash, index)` for every element, in unspecified order.
+  template <typename F>
+  void
+  for_each(F f) const
+  {
+    for (const Slot & slot : slots_) {
+      if (slot.index != empty)
+        f(slot.hash, slot.index);
+    }
+  }
+
+  size_t size() const { return size_; }
+
+  void
+  reserve(const size_t n)
+  {
+    while (2 * n > slots_.size())
+      grow();
+  }
+
+private:
+  static constexpr size_t empty = SIZE_MAX;
+
+  struct Slot
+  {
+    uint64_t hash;
+    size_t index;
+  };
+
+  void
+  grow()
+  {
+    std::vector<Slot> old(std::max<size_t>(16, 2 * slots_.size()), Slot{0, empty});
+    old.swap(slots_);
+    const size_t mask = slots_.size() - 1;
+    for (const Slot & slot : old) {
+      if (slot.index == empty) continue;
+      size_t s = slot.hash & mask;
+      while (slots_[s].index != empty)
+        s = (s + 1) & mask;
+      slots_[s] = slot;
+    }
+  }
+
+  std::vector<Slot> slots_;
+  size_t size_ = 0;
+};
+
+} // namespace detail
+
+// Returns an array of iterators to the first occurrences of the distinct values
+// in `[begin, end)`, in their original order (like `stable_unique_iterators()`),
+// split into `numThreads` chunks (0: the scheduler's concurrency)
+// that insert into a shared lock-free hash set.
+//
+// `hash(value)` must return the same value for values that are `equalPred`-equal.
+// Both are called concurrently.
+//
+// Complexity:
+// Given `N` as `last - first`:
+// * O(N) expected applications of `hash` and `equalPred`, divided among the threads
+// * 16 to 32 N bytes additional memory for the set (2 N slots of 8 bytes, rounded up
+//   to a power of two), N bytes for marking survivors
+template <
+  typename It,
+  typename Hash,
+  typename EqualPred = std::equal_to<>
+>
+std::vector<It>
+concurrent_hash_unique_iterators(
+  const It begin,
+  const It end,
+  Hash hash,
+  EqualPred equalPred = EqualPred{},
+  const size_t numThreads = 0
+)
+{
+  const size_t n = static_cast<size_t>(std::distance(begin, end));
+  const size_t threads = detail::resolve_num_threads(numThreads, n);
+
+  const auto keyAt = [begin](size_t i) -> decltype(auto) { return begin[static_cast<std::ptrdiff_t>(i)]; };
+  concurrent_index_set<decltype(keyAt), Hash, EqualPred> set(n, keyAt, hash, equalPred);
+
+  // Insert all elements. The set keeps the smallest index per distinct value.
+  detail::parallel_chunks(n, threads, [&set](size_t chunkBegin, size_t chunkEnd) {
+    for (size_t i = chunkBegin; i < chunkEnd; ++i)
+      set.insert(i);
+  });
+
+  // Mark the survivors; slots are disjoint, and so are the indices they hold.
+  std::vector<char> isUnique(n, 0);
+  const size_t capacity = set.capacity();
+  detail::parallel_chunks(capacity, threads, [&set, &isUnique](size_t slotBegin, size_t slotEnd) {
+    set.for_each_min_index(slotBegin, slotEnd, [&isUnique](size_t i){ isUnique[i] = 1; });
+  });
+
+  return detail::collect_marked(begin, n, isUnique);
+}
+
+// Returns an array of iterators to the first occurrences of the distinct values
+// in `[begin, end)`, in their original order (like `stable_unique_iterators()`),
+// split into `numThreads` chunks (0: the scheduler's concurrency), without atomics:
+//
+// 1. Each thread deduplicates a contiguous chunk into thread-local tables,
+//    one per shard, where the shard is chosen by the high bits of the hash.
+//    Scanning in order, each table keeps the first occurrence within the chunk.
+// 2. Shards are merged in parallel, each by one thread, visiting the
+//    chunks' tables in chunk order, so the first inserted (= smallest) index
+//    of each value wins. Shards hold disjoint values, so they need no locking.
+//
+// This is the parallel equivalent of `remove_if()` with `seen.insert(x).second`.
+//
+// `hash(value)` must return the same value for values that are `equalPred`-equal.
+// Both are called concurrently.
+//
+// Complexity:
+// Given `N` as `last - first`, and `U` the number of distinct values:
+// * O(N) expected applications of `hash` and `equalPred`, divided among the threads
+// * O(N + U) additional memory for tables (16 bytes per entry, at load factor 1/4 to 1/2)
+template <
+  typename It,
+  typename Hash,
+  typename EqualPred = std::equal_to<>
+>
+std::vector<It>
+sharded_hash_unique_iterators(
+  const It begin,
+  const It end,
+  Hash hash,
+  EqualPred equalPred = EqualPred{},
+  const size_t numThreads = 0
+)
+{
+  const size_t n = static_cast<size_t>(std::distance(begin, end));
+  const size_t threads = detail::resolve_num_threads(numThreads, n);
+
+  // Enough shards to balance the merge phase across threads;
+  // a single chunk needs no merge, so no shards.
+  unsigned shardBits = 0;
+  while (threads > 1 && (size_t{1} << shardBits) < 4 * threads)
+    ++shardBits;
+  const size_t numShards = size_t{1} << shardBits;
+  const auto shardOf = [shardBits](uint64_t h) { return shardBits == 0 ? 0 : static_cast<size_t>(h >> (64 - shardBits)); };
+
+  auto indexEqual = [begin, &equalPred](size_t a, size_t b) {
+    return equalPred(begin[static_cast<std::ptrdiff_t>(a)], begin[static_cast<std::ptrdiff_t>(b)]);
+  };
+
+  // Phase 1: thread-local deduplication of contiguous chunks. `local[c * numShards + s]`.
+  std::vector<detail::index_table> local(threads * numShards);
+  detail::parallel_chunks(threads, threads, [&](size_t cBegin, size_t cEnd) {
+    auto eq = indexEqual; // task-local copy of the functor
+    for (size_t c = cBegin; c < cEnd; ++c) {
+      const size_t chunkBegin = n * c / threads;
+      const size_t chunkEnd = n * (c + 1) / threads;
+      // Size for the all-distinct case (our common case), to avoid rehashing.
+      for (size_t s = 0; s < numShards; ++s)
+        local[c * numShards + s].reserve((chunkEnd - chunkBegin) / numShards);
+      for (size_t i = chunkBegin; i < chunkEnd; ++i) {
+        const uint64_t h = static_cast<uint64_t>(hash(begin[static_cast<std::ptrdiff_t>(i)]));
+        local[c * numShards + shardOf(h)].insert(h, i, eq);
+      }
+    }
+  });
+
+  // Phase 2: merge each shard over the chunks in order, and mark survivors.
+  std::vector<char> isUnique(n, 0);
+  detail::parallel_chunks(numShards, threads, [&](size_t sBegin, size_t sEnd) {
+    auto eq = indexEqual;
+    for (size_t s = sBegin; s < sEnd; ++s) {
+      if (threads == 1) {
+        // A single chunk is already deduplicated.
+        local[s].for_each([&](uint64_t, size_t i) { isUnique[i] = 1; });
+        continue;
+      }
+      size_t total = 0;
+      for (size_t c = 0; c < threads; ++c)
+        total += local[c * numShards + s].size();
+      detail::index_table merged;
+      merged.reserve(total);
+      for (size_t c = 0; c < threads; ++c) {
+        detail::index_table & table = local[c * numShards + s];
+        table.for_each([&](uint64_t h, size_t i) {
+          if (merged.insert(h, i, eq))
+            isUnique[i] = 1;
+        });
+        table = detail::index_table(); // free early
+      }
+    }
+  });
+
+  return detail::collect_marked(begin, n, isUnique);
+}
+
+} // namespace iterator_sorting
+
+#endif // PARALLEL_UNIQUIFY_H
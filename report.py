@@ -0,0 +1,286 @@
+#!/usr/bin/env python3
+"""Rebuilds the speedup tables and graph of README.md from benchmark results.
+
+Reads the files written by `./bench --json FILE` or `./bench --csv FILE`
+(several files, e.g. from different machines or commits, may be given), and
+
+* prints, per machine, dataset and element type, a table of speedup factors
+  of `--ref` over each `--vs` algorithm per input size, in the README layout
+  (median time of the other algorithm / median time of `--ref`; > 1: `--ref` is faster);
+* with `--svg FILE`, draws these factors over `n` as a line chart
+  (for the first table, or the one selected by `--dataset` and `--element`);
+* with `--memory`, instead prints the peak extra memory per element of
+  each algorithm, like the "Memory usage" table of README.md;
+* with `--baseline FILE`, instead prints how the median times changed
+  relative to the results in FILE (e.g. from the previous commit).
+
+Only uses the Python standard library.
+
+Examples:
+
+    ./bench --json results.json
+    ./report.py results.json --svg graph.svg
+    ./report.py results.json --ref stable_unique_iterators --vs unstable_unique_iterators
+    ./report.py results.json --memory
+    ./report.py new.json --baseline old.json
+"""
+
+import argparse
+import csv
+import json
+import math
+import os
+import sys
+from collections import OrderedDict
+
+MACHINE_FIELDS = ["timestamp", "revision", "command", "cpu", "hardware_threads", "memory_bytes", "simd_level", "compiler"]
+NUMBER_FIELDS = ["element_bytes", "n", "threads", "reps", "uniques"]
+FLOAT_FIELDS = ["min_s", "median_s", "p90_s", "mean_s", "stddev_s", "cold_min_s", "cold_median_s", "cold_p90_s", "peak_heap_bytes", "peak_rss_bytes"]
+
+
+def load(path):
+    """Returns the result records of a `--json` or `--csv` file, each with a "machine" dict."""
+    records = []
+    if path.endswith(".json"):
+        with open(path) as f:
+            data = json.load(f)
+        for r in data["results"]:
+            r["machine"] = data["machine"]
+            records.append(r)
+    else:
+        with open(path, newline="") as f:
+            for row in csv.DictReader(f):
+                if row.get("timestamp") == "timestamp":
+                    continue  # header of a concatenated file
+                r = {k: v for k, v in row.items() if k not in MACHINE_FIELDS}
+                r["machine"] = {k: row.get(k, "") for k in MACHINE_FIELDS}
+                for k in NUMBER_FIELDS:
+                    r[k] = int(r[k])
+                for k in FLOAT_FIELDS:
+                    r[k] = float(r[k]) if r.get(k) not in (None, "", "null") else None
+                records.append(r)
+    return records
+
+
+def machine_label(machine):
+    return "%s, %s threads, %s, %s, revision %s" % (
+        machine.get("cpu") or "unknown CPU",
+        machine.get("hardware_threads"),
+        machine.get("simd_level"),
+        machine.get("compiler"),
+        machine.get("revision"),
+    )
+
+
+def group(records):
+    """Groups records by machine, dataset, element type and threads, in order of appearance.
+    Returns {key: {n: {algorithm: record}}}."""
+    groups = OrderedDict()
+    for r in records:
+        key = (machine_label(r["machine"]), r["dataset"], r["element_type"], r["threads"])
+        groups.setdefault(key, OrderedDict()).setdefault(r["n"], {})[r["algorithm"]] = r
+    return groups
+
+
+def speedups(by_n, ref, others, field="median_s"):
+    """Returns [(n, [factor or None per other])] of median(other) / median(ref),
+    of the medians in `field` (e.g. "cold_median_s")."""
+    rows = []
+    for n in sorted(by_n):
+        algos = by_n[n]
+        base = algos.get(ref)
+        factors = []
+        for other in others:
+            o = algos.get(other)
+            if base and o and base.get(field) and o.get(field) is not None:
+                factors.append(o[field] / base[field])
+            else:
+                factors.append(None)
+        rows.append((n, factors))
+    return rows
+
+
+def format_table(rows, others):
+    """Formats speedup factors like the tables in README.md."""
+    widths = [max(len(o), 4) + 3 for o in others]
+    total = sum(widths) - 3
+    title = " speedup factor over "
+    dashes = max(total - len(title), 2)
+    lines = [
+        "           n   |" + "-" * (dashes // 2) + title + "-" * (dashes - dashes // 2) + "|   notes",
+        "               " + "".join(o.ljust(w) for o, w in zip(others, widths)).rstrip(),
+        "",
+    ]
+    for n, factors in rows:
+        cells = "".join(("%.1f" % f if f is not None else "-").ljust(w) for f, w in zip(factors, widths))
+        faster = [o for o, f in zip(others, factors) if f is not None and f < 1]
+        notes = ", ".join(faster) + (" is faster" if len(faster) == 1 else " are faster") if faster else ""
+        lines.append(("%12d   " % n + cells + notes).rstrip())
+    return "\n".join(lines)
+
+
+def nice_ticks(lo, hi, count=6):
+    """Round tick values covering [lo, hi]."""
+    span = hi - lo if hi > lo else 1.0
+    raw = span / count
+    magnitude = 10 ** math.floor(math.log10(raw))
+    step = min((m * magnitude for m in (1, 2, 5, 10) if m * magnitude >= raw), default=10 * magnitude)
+    first = math.floor(lo / step) * step
+    ticks = []
+    t = first
+    while t <= hi + step * 1e-9:
+        ticks.append(round(t, 10))
+        t += step
+    return ticks
+
+
+def svg_chart(rows, others, title, subtitle):
+    """A line chart of the speedup factors over n (log scale), as an SVG document."""
+    width, height = 640, 420
+    left, right, top, bottom = 60, 170, 50, 50
+    plot_w, plot_h = width - left - right, height - top - bottom
+    colors = ["#1f77b4", "#ff7f0e", "#2ca02c", "#d62728", "#9467bd", "#8c564b", "#e377c2", "#7f7f7f"]
+
+    ns = [n for n, _ in rows]
+    values = [f for _, factors in rows for f in factors if f is not None] + [1.0]
+    x_lo, x_hi = math.log10(min(ns)), math.log10(max(ns))
+    if x_hi == x_lo:
+        x_lo, x_hi = x_lo - 0.5, x_hi + 0.5
+    y_ticks = nice_ticks(0.0, max(values))
+    y_lo, y_hi = y_ticks[0], y_ticks[-1]
+
+    def x(n):
+        return left + (math.log10(n) - x_lo) / (x_hi - x_lo) * plot_w
+
+    def y(v):
+        return top + (1 - (v - y_lo) / (y_hi - y_lo)) * plot_h
+
+    def esc(s):
+        return s.replace("&", "&amp;").replace("<", "&lt;").replace(">", "&gt;")
+
+    out = [
+        '<?xml version="1.0" encoding="UTF-8"?>',
+        '<svg xmlns="http://www.w3.org/2000/svg" width="%d" height="%d" viewBox="0 0 %d %d" font-family="sans-serif" font-size="12">' % (width, height, width, height),
+        '<rect width="100%" height="100%" fill="white"/>',
+        '<text x="%d" y="20" font-size="14">%s</text>' % (left, esc(title)),
+        '<text x="%d" y="36" font-size="10" fill="#555">%s</text>' % (left, esc(subtitle)),
+    ]
+    for v in y_ticks:
+        out.append('<line x1="%d" x2="%d" y1="%.1f" y2="%.1f" stroke="#ddd"/>' % (left, left + plot_w, y(v), y(v)))
+        out.append('<text x="%d" y="%.1f" text-anchor="end">%g</text>' % (left - 6, y(v) + 4, v))
+    for e in range(math.ceil(x_lo), math.floor(x_hi) + 1):
+        out.append('<line x1="%.1f" x2="%.1f" y1="%d" y2="%d" stroke="#ddd"/>' % (x(10 ** e), x(10 ** e), top, top + plot_h))
+        out.append('<text x="%.1f" y="%d" text-anchor="middle">1e%d</text>' % (x(10 ** e), top + plot_h + 16, e))
+    out.append('<line x1="%d" x2="%d" y1="%.1f" y2="%.1f" stroke="black" stroke-dasharray="4 3"/>' % (left, left + plot_w, y(1), y(1)))
+    out.append('<rect x="%d" y="%d" width="%d" height="%d" fill="none" stroke="black"/>' % (left, top, plot_w, plot_h))
+    out.append('<text x="%.1f" y="%d" text-anchor="middle">n</text>' % (left + plot_w / 2, height - 12))
+    out.append('<text transform="translate(16 %.1f) rotate(-90)" text-anchor="middle">speedup factor</text>' % (top + plot_h / 2))
+
+    for i, other in enumerate(others):
+        color = colors[i % len(colors)]
+        points = [(x(n), y(factors[i])) for n, factors in rows if factors[i] is not None]
+        if points:
+            out.append('<polyline fill="none" stroke="%s" stroke-width="2" points="%s"/>' % (color, " ".join("%.1f,%.1f" % p for p in points)))
+            out.extend('<circle cx="%.1f" cy="%.1f" r="3" fill="%s"/>' % (px, py, color) for px, py in points)
+        ly = top + 10 + 18 * i
+        out.append('<line x1="%d" x2="%d" y1="%d" y2="%d" stroke="%s" stroke-width="2"/>' % (left + plot_w + 12, left + plot_w + 32, ly, ly, color))
+        out.append('<text x="%d" y="%d">%s</text>' % (left + plot_w + 38, ly + 4, esc(other)))
+    out.append("</svg>")
+    return "\n".join(out) + "\n"
+
+
+def print_memory(groups):
+    """Prints, per group and for its largest n, the peak extra heap and RSS bytes per element of each algorithm."""
+    def per_element(value, n):
+        return "-" if value is None else "%.0f" % (value / max(n, 1))
+
+    for (machine, dataset, element, threads), by_n in groups.items():
+        n = max(by_n)
+        print("On %s" % machine)
+        print("Dataset %s, %s, %d threads, n = %d:" % (dataset, element, threads, n))
+        print()
+        print("```")
+        print("what                                 Bytes per element")
+        print("                                     heap      RSS")
+        print()
+        for algorithm, r in by_n[n].items():
+            heap = per_element(r.get("peak_heap_bytes"), n)
+            rss = per_element(r.get("peak_rss_bytes"), n)
+            print("%-36s %5s    %5s" % (algorithm, heap, rss))
+        print("```")
+        print()
+
+
+def print_baseline(records, baseline, ref_machine_label):
+    """Prints median time ratios current / baseline per dataset, element type, n and algorithm."""
+    old = {(r["dataset"], r["element_type"], r["threads"], r["n"], r["algorithm"]): r for r in baseline}
+    print("Median time relative to baseline (< 1: faster now)")
+    print("  baseline: " + ref_machine_label)
+    last = None
+    for r in records:
+        key = (r["dataset"], r["element_type"], r["threads"], r["n"], r["algorithm"])
+        b = old.get(key)
+        if not b or not b["median_s"] or r["median_s"] is None:
+            continue
+        if key[:3] != last:
+            last = key[:3]
+            print()
+            print("%s, %s, %d threads:" % last)
+        print("  %12d  %-40s %6.2f" % (r["n"], r["algorithm"], r["median_s"] / b["median_s"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("files", nargs="+", help="results of ./bench --json or --csv")
+    parser.add_argument("--ref", default="stable_unique_iterators", help="algorithm whose speedup is shown (default: %(default)s)")
+    parser.add_argument("--vs", default="unordered_set,flat_hash_set", help="comma-separated algorithms to compare against (default: %(default)s)")
+    parser.add_argument("--dataset", help="only datasets starting with this (e.g. dup50)")
+    parser.add_argument("--element", help="only element types starting with this (e.g. Point3D)")
+    parser.add_argument("--svg", help="write a chart of the first selected table to this file")
+    parser.add_argument("--cold", action="store_true", help="use the cold-cache medians of ./bench --cold")
+    parser.add_argument("--memory", action="store_true", help="print bytes per element instead of speedups")
+    parser.add_argument("--baseline", help="compare median times against these results instead")
+    args = parser.parse_args()
+
+    records = [r for path in args.files for r in load(path)]
+    if args.dataset:
+        records = [r for r in records if r["dataset"].startswith(args.dataset)]
+    if args.element:
+        records = [r for r in records if r["element_type"].startswith(args.element)]
+    if not records:
+        sys.exit("no results selected")
+
+    if args.baseline:
+        baseline = load(args.baseline)
+        print_baseline(records, baseline, machine_label(baseline[0]["machine"]) if baseline else "empty")
+        return
+
+    groups = group(records)
+    if args.memory:
+        print_memory(groups)
+        return
+
+    others = [o for o in args.vs.split(",") if o]
+    field = "cold_median_s" if args.cold else "median_s"
+    for (machine, dataset, element, threads), by_n in groups.items():
+        present = [o for o in others if any(o in algos for algos in by_n.values())]
+        print("On %s" % machine)
+        print("Dataset %s, %s, %d threads%s, %s vs:" % (dataset, element, threads, ", cold caches" if args.cold else "", args.ref))
+        print()
+        print("```")
+        print(format_table(speedups(by_n, args.ref, present, field), present))
+        print("```")
+        print()
+
+    if args.svg:
+        (machine, dataset, element, threads), by_n = next(iter(groups.items()))
+        present = [o for o in others if any(o in algos for algos in by_n.values())]
+        title = "Speedup of %s%s" % (args.ref, " (cold caches)" if args.cold else "")
+        subtitle = "%s; %s; %s" % (dataset.split(":")[0], element, machine)
+        with open(args.svg, "w") as f:
+            f.write(svg_chart(speedups(by_n, args.ref, present, field), present, title, subtitle))
+        print("Wrote %s" % os.path.abspath(args.svg))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,250 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+// Vectorised kernels for the hot loops of `iterator_sorting.h`.
+//
+// Provides:
+//
+// * `detail::compact_run_heads()`: given sorted fixed-width keys stored
+//   contiguously as 64-bit words, finds where runs of equal keys start,
+//   and compresses the indices of those run heads into an output buffer,
+//   branch-free. This replaces the `std::unique()`-style walk that
+//   dereferences two elements and branches on every step.
+//
+// On x86-64 with GCC or Clang, each kernel is compiled for several
+// instruction set levels (AVX-512F, AVX2, SSE2) in the same binary,
+// independent of `-march`, and the best level the CPU supports is
+// selected at first use. Other targets use the portable scalar version.
+// Use `simd_level_name(active_simd_level())` to see which one is in use,
+// and `set_simd_level()` to force a lower one (e.g. to compare or test them).
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ITERATOR_SORTING_X86_DISPATCH 1
+#include <immintrin.h>
+#define ITERATOR_SORTING_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace iterator_sorting {
+
+enum class simd_level { scalar, sse2, avx2, avx512f };
+
+inline const char *
+simd_level_name(const simd_level level)
+{
+  switch (level) {
+    case simd_level::scalar: return "scalar";
+    case simd_level::sse2: return "sse2";
+    case simd_level::avx2: return "avx2";
+    case simd_level::avx512f: return "avx512f";
+  }
+  return "unknown";
+}
+
+// The best level supported by the CPU we are running on.
+inline simd_level
+detect_simd_level()
+{
+#if defined(ITERATOR_SORTING_X86_DISPATCH)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return simd_level::avx512f;
+  // The AVX2 kernel also uses POPCNT, which hypervisors may mask separately.
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) return simd_level::avx2;
+  return simd_level::sse2; // baseline x86-64
+#else
+  return simd_level::scalar;
+#endif
+}
+
+namespace detail {
+
+inline std::atomic<simd_level> &
+simd_level_setting()
+{
+  static std::atomic<simd_level> level{detect_simd_level()};
+  return level;
+}
+
+} // namespace detail
+
+// The level the kernels use: the detected one, unless set by `set_simd_level()`.
+inline simd_level
+active_simd_level()
+{
+  return detail::simd_level_setting().load(std::memory_order_relaxed);
+}
+
+// Makes the kernels use `level` from now on. Levels the CPU does not support
+// are lowered to `detect_simd_level()`. Returns the level now in use.
+// Calls running concurrently may use either level.
+inline simd_level
+set_simd_level(const simd_level level)
+{
+  const simd_level supported = level < detect_simd_level() ? level : detect_simd_level();
+  detail::simd_level_setting().store(supported, std::memory_order_relaxed);
+  return supported;
+}
+
+namespace detail {
+
+// Layout of sorted key records for `compact_run_heads()`: record `i` is the
+// `stride` words at `words + i * stride`; its key is the words at the
+// `numKeyWords` offsets `keyWords`, its element index the word at `indexWord`.
+struct record_layout
+{
+  const uint64_t * words;
+  size_t stride;
+  const size_t * keyWords;
+  size_t numKeyWords;
+  size_t indexWord;
+};
+
+// Scalar part of `compact_run_heads()`, for positions `[i, end)` with `i >= 1`,
+// with `k` heads written so far.
+inline size_t
+compact_run_heads_scalar(const record_layout & r, size_t i, const size_t end, uint64_t * out, size_t k)
+{
+  for (; i < end; ++i) {
+    const uint64_t * cur = r.words + i * r.stride;
+    const uint64_t * prev = cur - r.stride;
+    bool isHead = false;
+    for (size_t w = 0; w < r.numKeyWords; ++w)
+      isHead |= cur[r.keyWords[w]] != prev[r.keyWords[w]];
+    out[k] = cur[r.indexWord];
+    k += isHead;
+  }
+  return k;
+}
+
+// The vectorised variants below process the positions `[i, end)` with `i >= 1`
+// in whole vectors, and leave the remainder to `compact_run_heads_scalar()`.
+// Lanes gather words `stride` apart; `prev` is the same lanes one record back.
+
+#if defined(ITERATOR_SORTING_X86_DISPATCH)
+
+ITERATOR_SORTING_TARGET("avx512f")
+inline size_t
+compact_run_heads_avx512f(const record_layout & r, size_t i, const size_t end, uint64_t * out, size_t k)
+{
+  const long long s = static_cast<long long>(r.stride);
+  const __m512i lanes = _mm512_setr_epi64(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+  const __m512i zero = _mm512_setzero_si512();
+  for (; i + 8 <= end; i += 8) {
+    const long long * base = reinterpret_cast<const long long *>(r.words + i * r.stride);
+    const long long * basePrev = base - r.stride;
+    __mmask8 equal = 0xff;
+    for (size_t w = 0; w < r.numKeyWords; ++w) {
+      const __m512i cur = _mm512_mask_i64gather_epi64(zero, 0xff, lanes, base + r.keyWords[w], 8);
+      const __m512i prev = _mm512_mask_i64gather_epi64(zero, 0xff, lanes, basePrev + r.keyWords[w], 8);
+      equal &= _mm512_cmpeq_epu64_mask(cur, prev);
+    }
+    const __mmask8 heads = static_cast<__mmask8>(~equal);
+    const __m512i idx = _mm512_mask_i64gather_epi64(zero, 0xff, lanes, base + r.indexWord, 8);
+    _mm512_mask_compressstoreu_epi64(out + k, heads, idx);
+    k += static_cast<size_t>(__builtin_popcount(heads));
+  }
+  return compact_run_heads_scalar(r, i, end, out, k);
+}
+
+// `compact_lanes_avx2[mask]`: `_mm256_permutevar8x32_epi32()` control moving
+// the 64-bit lanes set in the 4-bit `mask` to the front, in order.
+alignas(32) inline constexpr uint32_t compact_lanes_avx2[16][8] = {
+  {0, 1, 0, 1, 0, 1, 0, 1}, {0, 1, 0, 1, 0, 1, 0, 1}, {2, 3, 0, 1, 0, 1, 0, 1}, {0, 1, 2, 3, 0, 1, 0, 1},
+  {4, 5, 0, 1, 0, 1, 0, 1}, {0, 1, 4, 5, 0, 1, 0, 1}, {2, 3, 4, 5, 0, 1, 0, 1}, {0, 1, 2, 3, 4, 5, 0, 1},
+  {6, 7, 0, 1, 0, 1, 0, 1}, {0, 1, 6, 7, 0, 1, 0, 1}, {2, 3, 6, 7, 0, 1, 0, 1}, {0, 1, 2, 3, 6, 7, 0, 1},
+  {4, 5, 6, 7, 0, 1, 0, 1}, {0, 1, 4, 5, 6, 7, 0, 1}, {2, 3, 4, 5, 6, 7, 0, 1}, {0, 1, 2, 3, 4, 5, 6, 7},
+};
+
+ITERATOR_SORTING_TARGET("avx2,popcnt")
+inline size_t
+compact_run_heads_avx2(const record_layout & r, size_t i, const size_t end, uint64_t * out, size_t k)
+{
+  const long long s = static_cast<long long>(r.stride);
+  const __m256i lanes = _mm256_setr_epi64x(0, s, 2 * s, 3 * s);
+  for (; i + 4 <= end; i += 4) {
+    const long long * base = reinterpret_cast<const long long *>(r.words + i * r.stride);
+    const long long * basePrev = base - r.stride;
+    __m256i equal = _mm256_set1_epi64x(-1);
+    for (size_t w = 0; w < r.numKeyWords; ++w) {
+      const __m256i cur = _mm256_i64gather_epi64(base + r.keyWords[w], lanes, 8);
+      const __m256i prev = _mm256_i64gather_epi64(basePrev + r.keyWords[w], lanes, 8);
+      equal = _mm256_and_si256(equal, _mm256_cmpeq_epi64(cur, prev));
+    }
+    const unsigned heads = ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(equal))) & 0xf;
+    const __m256i idx = _mm256_i64gather_epi64(base + r.indexWord, lanes, 8);
+    const __m256i control = _mm256_load_si256(reinterpret_cast<const __m256i *>(compact_lanes_avx2[heads]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k), _mm256_permutevar8x32_epi32(idx, control));
+    k += static_cast<size_t>(__builtin_popcount(heads));
+  }
+  return compact_run_heads_scalar(r, i, end, out, k);
+}
+
+ITERATOR_SORTING_TARGET("sse2")
+inline size_t
+compact_run_heads_sse2(const record_layout & r, size_t i, const size_t end, uint64_t * out, size_t k)
+{
+  for (; i + 2 <= end; i += 2) {
+    const uint64_t * recPrev = r.words + (i - 1) * r.stride;
+    const uint64_t * rec0 = recPrev + r.stride;
+    const uint64_t * rec1 = rec0 + r.stride;
+    __m128i equal = _mm_set1_epi32(-1);
+    for (size_t w = 0; w < r.numKeyWords; ++w) {
+      const size_t o = r.keyWords[w];
+      const __m128i cur = _mm_set_epi64x(static_cast<long long>(rec1[o]), static_cast<long long>(rec0[o]));
+      const __m128i prev = _mm_set_epi64x(static_cast<long long>(rec0[o]), static_cast<long long>(recPrev[o]));
+      // SSE2 has no 64-bit compare: both 32-bit halves must be equal.
+      const __m128i eq32 = _mm_cmpeq_epi32(cur, prev);
+      equal = _mm_and_si128(equal, _mm_and_si128(eq32, _mm_shuffle_epi32(eq32, _MM_SHUFFLE(2, 3, 0, 1))));
+    }
+    const unsigned heads = ~static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(equal))) & 0x3;
+    out[k] = rec0[r.indexWord];
+    k += heads & 1;
+    out[k] = rec1[r.indexWord];
+    k += heads >> 1;
+  }
+  return compact_run_heads_scalar(r, i, end, out, k);
+}
+
+#endif // ITERATOR_SORTING_X86_DISPATCH
+
+// Number of entries `compact_run_heads()` may write past its result.
+inline constexpr size_t compact_run_heads_slack = 8;
+
+// For the positions `[begin, end)` of the sorted records `r`, writes the
+// element indices of the run heads (position 0, and positions whose key
+// differs from the previous one in any word) to `out`, in position order.
+// Returns the number of heads written; `out` must have room for
+// `end - begin + compact_run_heads_slack` entries.
+// Runs the variant for `level` (by default the `active_simd_level()`),
+// which the CPU must support.
+//
+// Complexity:
+// Given `N` as `end - begin`, and `K` as `r.numKeyWords`:
+// * O(N K) word reads, with no data-dependent branches
+inline size_t
+compact_run_heads(const record_layout & r, size_t begin, const size_t end, uint64_t * out, const simd_level level = active_simd_level())
+{
+  size_t k = 0;
+  if (begin == 0 && end != 0) {
+    out[k++] = r.words[r.indexWord];
+    ++begin;
+  }
+
+  switch (level) {
+#if defined(ITERATOR_SORTING_X86_DISPATCH)
+    case simd_level::avx512f: return compact_run_heads_avx512f(r, begin, end, out, k);
+    case simd_level::avx2: return compact_run_heads_avx2(r, begin, end, out, k);
+    case simd_level::sse2: return compact_run_heads_sse2(r, begin, end, out, k);
+#endif
+    default: return compact_run_heads_scalar(r, begin, end, out, k);
+  }
+}
+
+} // namespace detail
+
+} // namespace iterator_sorting
+
+#endif // SIMD_KERNELS_H
@@ -0,0 +1,308 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+// A small work-stealing task scheduler shared by all parallel algorithms
+// of this library, so that they do not each spawn their own threads.
+//
+// * Each worker has its own task deque. It pops tasks from the back of its own
+//   deque, and when that is empty, steals from the front of the others'.
+// * `parallel_for()` lets the calling thread participate, and hands out
+//   indices through a single atomic counter, so per-index overhead is one
+//   `fetch_add`, and nested `parallel_for()` calls from workers cannot deadlock.
+//   Below 2 indices, or without workers, it runs inline with no overhead;
+//   callers split small inputs into fewer indices (see `parallel_grain` in
+//   `parallel_uniquify.h`), so they do not pay for parallelism.
+// * Workers can be pinned to cores, or the scheduler can be told to run its
+//   tasks on a caller-provided executor (e.g. an existing thread pool) instead
+//   of its own threads.
+//
+// Use `default_scheduler()` for the library-wide instance, and
+// `configure_default_scheduler()` to set its options before first use.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace iterator_sorting {
+
+struct scheduler_options
+{
+  // Number of worker threads. The thread calling `parallel_for()` participates
+  // as well, so the default of `hardware_concurrency() - 1` uses all cores.
+  // Ignored if `executor` is set.
+  size_t numWorkers = std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1;
+
+  // Pin worker `i` to core `(i + 1) % hardware_concurrency()` (Linux only;
+  // core 0 is left for the caller).
+  bool pinWorkers = false;
+
+  // If set, tasks are handed to this function instead of own worker threads,
+  // and `concurrency` is assumed to be `executorConcurrency`.
+  std::function<void(std::function<void()>)> executor;
+  size_t executorConcurrency = 1;
+};
+
+class task_scheduler
+{
+public:
+  explicit task_scheduler(scheduler_options options = scheduler_options{})
+    : options_(std::move(options))
+    , numWorkers_(options_.executor ? 0 : options_.numWorkers)
+  {
+    if (numWorkers_ == 0)
+      return;
+    for (size_t i = 0; i < numWorkers_; ++i)
+      queues_.push_back(std::make_unique<task_queue>());
+    queues_.push_back(std::make_unique<task_queue>()); // injection queue for non-worker threads
+    workers_.reserve(numWorkers_);
+    for (size_t i = 0; i < numWorkers_; ++i) {
+      workers_.emplace_back([this, i]{ worker_loop(i); });
+#if defined(__linux__)
+      if (options_.pinWorkers) {
+        const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET((i + 1) % cores, &set);
+        pthread_setaffinity_np(workers_.back().native_handle(), sizeof(set), &set);
+      }
+#endif
+    }
+  }
+
+  ~task_scheduler()
+  {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex_);
+      stop_ = true;
+    }
+    sleepCv_.notify_all();
+    for (std::thread & t : workers_)
+      t.join();
+  }
+
+  task_scheduler(const task_scheduler &) = delete;
+  task_scheduler & operator=(const task_scheduler &) = delete;
+
+  // Number of threads that can run tasks of a `parallel_for()` at once
+  // (workers plus the calling thread).
+  size_t
+  concurrency() const
+  {
+    return options_.executor ? std::max<size_t>(options_.executorConcurrency, 1) : numWorkers_ + 1;
+  }
+
+  // Calls `f(i)` for each `i` in `[0, numTasks)`, in parallel, and returns when all calls have returned.
+  // The calling thread runs tasks as well.
+  // If calls throw, the remaining indices are skipped, and the first exception
+  // is rethrown on the calling thread once no call is running any more.
+  template <typename F>
+  void
+  parallel_for(const size_t numTasks, F && f)
+  {
+    if (numTasks == 0) return;
+    const size_t helpers = std::min(numTasks, concurrency()) - 1;
+    if (helpers == 0) {
+      for (size_t i = 0; i < numTasks; ++i)
+        f(i);
+      return;
+    }
+
+    // Helpers may start after all indices are taken (even after we returned),
+    // so they share ownership of the group state and only touch `f` after
+    // claiming an index, which guarantees that we are still waiting.
+    auto group = std::make_shared<task_group>();
+    group->numTasks = numTasks;
+    group->run = [&f](size_t i){ f(i); };
+    for (size_t h = 0; h < helpers; ++h)
+      submit([group]{ group->work(); });
+
+    group->work();
+    // Help with other work (e.g. helpers of nested calls) while waiting.
+    while (group->done.load(std::memory_order_acquire) != numTasks) {
+      if (!try_run_one())
+        std::this_thread::yield();
+    }
+    if (group->failed.load(std::memory_order_acquire))
+      std::rethrow_exception(group->error);
+  }
+
+  // Runs `task` asynchronously. Without workers or executor, runs it inline.
+  void
+  submit(std::function<void()> task)
+  {
+    if (options_.executor) {
+      options_.executor(std::move(task));
+      return;
+    }
+    if (numWorkers_ == 0) {
+      task();
+      return;
+    }
+    task_queue & q = *queues_[current_worker_index()];
+    {
+      std::lock_guard<std::mutex> lock(q.mutex);
+      q.tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex_);
+      ++pending_;
+    }
+    sleepCv_.notify_one();
+  }
+
+private:
+  struct task_queue
+  {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  struct task_group
+  {
+    size_t numTasks = 0;
+    std::function<void(size_t)> run;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error; // the first exception thrown by `run`; guarded by errorMutex
+    std::mutex errorMutex;
+
+    // Claimed indices are always counted as done, even if skipped or failed,
+    // so that the caller's wait ends.
+    void
+    work()
+    {
+      for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < numTasks; ) {
+        if (!failed.load(std::memory_order_relaxed)) {
+          try {
+            run(i);
+          } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) {
+              error = std::current_exception();
+              failed.store(true, std::memory_order_release);
+            }
+          }
+        }
+        done.fetch_add(1, std::memory_order_release);
+      }
+    }
+  };
+
+  // The queue index of the calling thread: its own queue for workers of this
+  // scheduler, the injection queue otherwise.
+  size_t
+  current_worker_index() const
+  {
+    return currentScheduler() == this ? currentIndex() : numWorkers_;
+  }
+
+  static const task_scheduler * & currentScheduler() { thread_local const task_scheduler * s = nullptr; return s; }
+  static size_t & currentIndex() { thread_local size_t i = 0; return i; }
+
+  bool
+  pop_from(const size_t q, const bool back, std::function<void()> & task)
+  {
+    task_queue & queue = *queues_[q];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    if (back) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    return true;
+  }
+
+  // Runs one queued task: from the own queue's back if possible, else stolen
+  // from the front of another queue. Returns false if there was none.
+  bool
+  try_run_one()
+  {
+    if (numWorkers_ == 0) return false;
+    const size_t self = current_worker_index();
+    std::function<void()> task;
+    bool found = pop_from(self, true, task);
+    for (size_t k = 1; !found && k < queues_.size(); ++k)
+      found = pop_from((self + k) % queues_.size(), false, task);
+    if (!found) return false;
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex_);
+      --pending_;
+    }
+    task();
+    return true;
+  }
+
+  void
+  worker_loop(const size_t index)
+  {
+    currentScheduler() = this;
+    currentIndex() = index;
+    for (;;) {
+      if (try_run_one()) continue;
+      std::unique_lock<std::mutex> lock(sleepMutex_);
+      sleepCv_.wait(lock, [this]{ return pending_ > 0 || stop_; });
+      if (stop_ && pending_ == 0) return;
+    }
+  }
+
+  scheduler_options options_;
+  const size_t numWorkers_;
+  std::vector<std::unique_ptr<task_queue>> queues_; // one per worker, plus the injection queue
+  std::vector<std::thread> workers_;
+
+  std::mutex sleepMutex_;
+  std::condition_variable sleepCv_;
+  // Tasks queued but not yet taken; guarded by sleepMutex_. Signed, because a task
+  // can be taken before `submit()` has counted it, which briefly makes it -1.
+  std::ptrdiff_t pending_ = 0;
+  bool stop_ = false;
+};
+
+namespace detail {
+
+inline std::mutex & default_scheduler_mutex() { static std::mutex m; return m; }
+inline std::unique_ptr<task_scheduler> & default_scheduler_instance() { static std::unique_ptr<task_scheduler> s; return s; }
+
+} // namespace detail
+
+// (Re)creates the library-wide scheduler with `options`.
+// Must not be called while the scheduler is in use.
+inline void
+configure_default_scheduler(scheduler_options options)
+{
+  std::lock_guard<std::mutex> lock(detail::default_scheduler_mutex());
+  detail::default_scheduler_instance().reset(); // join old workers first
+  detail::default_scheduler_instance() = std::make_unique<task_scheduler>(std::move(options));
+}
+
+// The library-wide scheduler, created with default options on first use.
+inline task_scheduler &
+default_scheduler()
+{
+  std::lock_guard<std::mutex> lock(detail::default_scheduler_mutex());
+  std::unique_ptr<task_scheduler> & s = detail::default_scheduler_instance();
+  if (!s)
+    s = std::make_unique<task_scheduler>();
+  return *s;
+}
+
+} // namespace iterator_sorting
+
+#endif // TASK_SCHEDULER_H